@@ -0,0 +1,479 @@
+#ifndef BATCH_CPP
+#define BATCH_CPP
+#include "batch.hpp"
+#include "budget.hpp"
+#include "cache.hpp"
+#include "engine.hpp"
+#include "grid.hpp"
+#include "io.hpp"
+#include "pack.hpp"
+#include "parallel.hpp"
+#include "portfolio.hpp"
+#include "sliced.hpp"
+#include "thread_pool.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+static const size_t BATCH_WINDOW = 1 << 16; // Puzzles parsed, solved and written per round, bounds the memory use
+static const size_t BATCH_CHUNK = 512; // Most puzzles per pool task, large enough to hide the queueing cost
+static const size_t TASKS_PER_THREAD = 16; // Lower bound on tasks per worker so a few hard puzzles can be stolen around
+static const size_t SLICED_GROUP = 64; // Puzzles of a chunk parsed and propagated together by the sliced engine
+static const uint64_t PORTFOLIO_SLICE = 256; // Nodes of every strategy's first turn, most easy puzzles need fewer
+
+/// @brief Solves one puzzle into an output line. Invalid or unsolvable puzzles, and puzzles that ran out of budget, are
+///         written as a line of dots so the output keeps one line per input puzzle.
+/// @param in The input characters, or a 41-byte packed board.
+/// @param packed True if in is a packed board, only for 9x9.
+/// @param out Receives the solved cells and a newline.
+/// @param options The engine (the sizes other than 9x9 always backtrack), the heuristic and the budget of a puzzle.
+/// @param cache The solution cache in front of the engine, nullptr for none. Only used for 9x9.
+/// @return solved, unsolvable (also for an invalid puzzle), or exhausted/cancelled if the budget ran out.
+template<int Box>
+static Outcome solve_line(const char* in, bool packed, char* out, const BatchOptions& options, SolutionCache* cache){
+
+    const int cells = BasicGrid<Box>::CELLS;
+    BasicGrid<Box> grid;
+    optional<BudgetScope> budget;
+    bool solved;
+    {
+        STAT_PHASE(parse_seconds);
+        if constexpr(Box == 3){
+            solved = packed ? unpack_board((const uint8_t*)in, grid) : grid.parse(in);
+        }
+        else{
+            solved = grid.parse(in);
+        }
+    }
+    if(solved){
+        STAT_PHASE(solve_seconds);
+        if(options.budget.limited()){
+            budget.emplace(options.budget);
+        }
+        if constexpr(Box == 3){
+            solved = cache ? solve_cached(grid, options.engine, *cache, options.heuristic)
+                           : solve_grid(grid, options.engine, options.heuristic);
+        }
+        else{
+            solved = solve_heuristic(grid, options.heuristic);
+        }
+    }
+
+    if(solved){
+        grid.format(out);
+    }
+    else{
+        fill(out, out + cells, '.');
+    }
+    out[cells] = '\n';
+
+    if(budget && budget->stopped()){
+        return budget->stop_reason();
+    }
+    return solved ? Outcome::solved : Outcome::unsolvable;
+}
+
+using LineSolver = Outcome (*)(const char* in, bool packed, char* out, const BatchOptions& options,
+                               SolutionCache* cache);
+
+/// @brief Returns the solve_line instantiation for a box size, 9x9 for any size that is not supported.
+static LineSolver line_solver(int box){
+    switch(box){
+        case 2: return solve_line<2>;
+        case 4: return solve_line<4>;
+        case 5: return solve_line<5>;
+    }
+    return solve_line<3>;
+}
+
+/// @brief What the portfolio did on one puzzle, with cheap features of the puzzle to learn an up-front pick from.
+struct PortfolioRecord{
+    int winner = -1; // Strategy that finished, -1 if none did or the puzzle could not be read
+    int givens = 0;
+    int candidates = 0; // Candidates over the empty cells before any search
+    uint64_t nodes = 0; // Nodes of every turn of every strategy
+    int rounds = 0;
+    double seconds = 0; // Every turn together
+
+    string json(size_t puzzle, const vector<Strategy>& strategies) const;
+};
+
+/// @brief Formats a record as one JSON object, without a newline.
+string PortfolioRecord::json(size_t puzzle, const vector<Strategy>& strategies) const{
+    return "{\"puzzle\": " + to_string(puzzle) + ", \"winner\": " +
+           (winner >= 0 ? "\"" + strategy_name(strategies[winner]) + "\"" : string("null")) +
+           ", \"givens\": " + to_string(givens) + ", \"candidates\": " + to_string(candidates) +
+           ", \"nodes\": " + to_string(nodes) + ", \"rounds\": " + to_string(rounds) +
+           ", \"seconds\": " + to_string(seconds) + "}";
+}
+
+/// @brief Solves one 9x9 puzzle into an output line with the portfolio of the options, written as in solve_line.
+/// @param record Receives the winner, the features of the puzzle and the cost.
+/// @return As solve_line.
+static Outcome solve_portfolio_line(const char* in, bool packed, char* out, const BatchOptions& options,
+                                    PortfolioRecord& record){
+
+    Grid grid;
+    bool parsed;
+    {
+        STAT_PHASE(parse_seconds);
+        parsed = packed ? unpack_board((const uint8_t*)in, grid) : grid.parse(in);
+    }
+    Outcome outcome = Outcome::unsolvable;
+
+    if(parsed){
+        STAT_PHASE(solve_seconds);
+        for(int cell = 0; cell < 81; cell++){
+            record.givens += grid.get(cell) != 0;
+            record.candidates += grid.get(cell) ? 0 : __builtin_popcount(grid.candidates(cell));
+        }
+
+        auto start = chrono::steady_clock::now();
+        PortfolioResult result = staged_portfolio(grid, options.portfolio, options.budget, PORTFOLIO_SLICE);
+        outcome = result.result.outcome;
+        grid = result.result.grid;
+        record.winner = result.winner;
+        record.nodes = result.nodes;
+        record.rounds = result.rounds;
+        record.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+
+    if(outcome == Outcome::solved){
+        grid.format(out);
+    }
+    else{
+        fill(out, out + 81, '.');
+    }
+    out[81] = '\n';
+    return outcome;
+}
+
+/// @brief One window of puzzles: the pointers to its lines in the mapped input, and the output and stats slots.
+struct BatchWindow{
+    vector<const char*> lines;
+    vector<char> out;
+    vector<size_t> solved; // Solved puzzles per chunk
+    vector<size_t> exhausted; // Puzzles per chunk that ran out of budget
+    vector<SearchStats> stats; // Stats per chunk, or per puzzle when per-puzzle stats are written
+    vector<PortfolioRecord> records; // Per puzzle with a portfolio
+    size_t first = 0; // Index of the first puzzle of the window in the whole file
+};
+
+/// @brief Solves the 9x9 puzzles of one chunk of a window with the sliced engine. The puzzles are propagated together,
+///         SLICED_GROUP at a time (see propagate_sliced), and only the ones left open are searched, one by one with the
+///         heuristic and the budget of the options. The output lines are written as in solve_line.
+/// @param chunk The chunk, puzzles first..last - 1 of the window. Receives its solved and exhausted counts and stats.
+static void solve_sliced_chunk(BatchWindow& window, size_t chunk, size_t first, size_t last, bool packed,
+                               const BatchOptions& options){
+
+    const size_t line_width = 82;
+    Grid grids[SLICED_GROUP];
+    bool parsed[SLICED_GROUP];
+    SlicedState states[SLICED_GROUP];
+    size_t count = 0;
+    size_t exhausted = 0;
+
+    for(size_t group = first; group < last; group += SLICED_GROUP){
+        size_t size = min(SLICED_GROUP, last - group);
+        if(STATS_ENABLED){
+            thread_stats = SearchStats();
+        }
+        {
+            STAT_PHASE(parse_seconds);
+            for(size_t j = 0; j < size; j++){
+                const char* in = window.lines[group + j];
+                parsed[j] = packed ? unpack_board((const uint8_t*)in, grids[j]) : grids[j].parse(in);
+                if(!parsed[j]){
+                    grids[j] = Grid(); // Takes a lane like the others, its result is not used
+                }
+            }
+        }
+
+        {
+            STAT_PHASE(solve_seconds);
+            propagate_sliced(grids, size, states);
+
+            for(size_t j = 0; j < size; j++){
+                Outcome outcome = parsed[j] && states[j] == SlicedState::solved ? Outcome::solved : Outcome::unsolvable;
+
+                if(parsed[j] && states[j] == SlicedState::open){
+                    optional<BudgetScope> budget;
+                    if(options.budget.limited()){
+                        budget.emplace(options.budget);
+                    }
+                    outcome = solve_heuristic(grids[j], options.heuristic) ? Outcome::solved : Outcome::unsolvable;
+                    if(budget && budget->stopped()){
+                        outcome = budget->stop_reason();
+                    }
+                }
+
+                char* out = &window.out[(group + j) * line_width];
+                if(outcome == Outcome::solved){
+                    grids[j].format(out);
+                }
+                else{
+                    fill(out, out + 81, '.');
+                }
+                out[81] = '\n';
+                count += outcome == Outcome::solved;
+                exhausted += outcome == Outcome::exhausted || outcome == Outcome::cancelled;
+            }
+        }
+        if(STATS_ENABLED){
+            thread_stats.puzzles = size;
+            window.stats[chunk].merge(thread_stats);
+        }
+    }
+    window.solved[chunk] = count;
+    window.exhausted[chunk] = exhausted;
+}
+
+/// @brief Solves one puzzle into an output line with every worker of the pool, like solve_line.
+template<int Box>
+static bool split_line(const char* in, bool packed, char* out, ThreadPool& pool){
+
+    const int cells = BasicGrid<Box>::CELLS;
+    BasicGrid<Box> grid;
+    bool solved;
+    if constexpr(Box == 3){
+        solved = packed ? unpack_board((const uint8_t*)in, grid) : grid.parse(in);
+    }
+    else{
+        solved = grid.parse(in);
+    }
+    solved = solved && solve_parallel(grid, pool);
+
+    if(solved){
+        grid.format(out);
+    }
+    else{
+        fill(out, out + cells, '.');
+    }
+    out[cells] = '\n';
+    return solved;
+}
+
+using SplitSolver = bool (*)(const char* in, bool packed, char* out, ThreadPool& pool);
+
+/// @brief Returns the split_line instantiation for a box size, 9x9 for any size that is not supported.
+static SplitSolver split_solver(int box){
+    switch(box){
+        case 2: return split_line<2>;
+        case 4: return split_line<4>;
+        case 5: return split_line<5>;
+    }
+    return split_line<3>;
+}
+
+/// @brief Solves every puzzle of a file on a work-stealing thread pool.
+///         The file is memory mapped and the puzzles are parsed in place. It is processed in windows of BATCH_WINDOW
+///         puzzles: while the pool solves one window straight into its slots of the output buffer, the main thread
+///         writes out the previous one, so memory stays bounded whatever the file size and the output comes out in
+///         input order without any locking between workers. Lines shorter than a board (81 characters for 9x9) and
+///         lines starting with '#' are skipped. A packed container (see pack.hpp) is read record by record instead.
+///         With options.split the puzzles of a window are solved one after another instead, each by the whole pool.
+///         With the sliced engine every chunk propagates its puzzles in groups before searching any of them.
+/// @param options The input and output files, the number of threads, the engine, heuristic and budget, the box size,
+///         the cache size and the stats files.
+/// @return The number of puzzles read and solved and the time it took.
+BatchResult solve_batch(const BatchOptions& options){
+
+    MappedFile input;
+    BufferedWriter output;
+    BufferedWriter stats_output;
+
+    // Handle invalid text file
+    if(!input.open(options.input)){
+        cerr << "ERROR: Failed to open " << options.input << ", check if file exists and try again." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(!output.open(options.output)){
+        cerr << "ERROR: Failed to open " << options.output << " for writing." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(!options.puzzle_stats.empty() && !stats_output.open(options.puzzle_stats)){
+        cerr << "ERROR: Failed to open " << options.puzzle_stats << " for writing." << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // Packed containers are read record by record, text files line by line.
+    PackHeader header;
+    bool packed = is_pack(input.data(), input.size());
+    if(packed && !read_pack_header(input.data(), input.size(), header)){
+        cerr << "ERROR: " << options.input << " has a corrupt packed puzzle header." << endl;
+        exit(EXIT_FAILURE);
+    }
+    uint64_t next_record = 0;
+
+    LineSolver solve = line_solver(options.box);
+    size_t cells = options.box * options.box * options.box * options.box;
+    size_t line_width = cells + 1;
+    if(options.box != 3 && (packed || options.engine != Engine::backtrack || options.cache > 0)){
+        cerr << "ERROR: Packed input, the dlx engine and the solution cache only support 9x9 puzzles." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(options.split && (options.engine != Engine::backtrack || options.heuristic != Heuristic::first ||
+                         options.budget.limited() || options.cache > 0 || !options.stats.empty() ||
+                         !options.puzzle_stats.empty())){
+        cerr << "ERROR: Split solving has its own search, it cannot be combined with the dlx engine, a heuristic, a "
+             << "budget, the solution cache or the stats." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(options.engine == Engine::sliced && (options.cache > 0 || !options.puzzle_stats.empty())){
+        cerr << "ERROR: The sliced engine solves puzzles in groups, it cannot be combined with the solution cache or "
+             << "per-puzzle stats." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(!options.portfolio.empty() && (options.box != 3 || options.split || options.engine != Engine::backtrack ||
+                                      options.heuristic != Heuristic::first || options.cache > 0)){
+        cerr << "ERROR: A portfolio picks the engine and heuristic of every 9x9 puzzle itself, it cannot be combined "
+             << "with another size, split solving, --engine, --heuristic or the solution cache." << endl;
+        exit(EXIT_FAILURE);
+    }
+    BufferedWriter portfolio_log;
+    if(!options.portfolio_log.empty() && !portfolio_log.open(options.portfolio_log)){
+        cerr << "ERROR: Failed to open " << options.portfolio_log << " for writing." << endl;
+        exit(EXIT_FAILURE);
+    }
+    SplitSolver split = split_solver(options.box);
+    unique_ptr<SolutionCache> cache;
+    if(options.cache > 0){
+        cache = make_unique<SolutionCache>(options.cache);
+    }
+
+    bool per_puzzle = STATS_ENABLED && !options.puzzle_stats.empty();
+    LineScanner scanner(input.data(), packed ? 0 : input.size(), cells);
+    BatchResult result;
+    result.wins.assign(options.portfolio.size(), 0);
+
+    BatchWindow windows[2];
+    for(BatchWindow& window : windows){
+        window.lines.reserve(BATCH_WINDOW);
+        window.out.resize(BATCH_WINDOW * line_width);
+    }
+
+    auto start = chrono::steady_clock::now();
+    {
+        ThreadPool pool(options.threads);
+
+        size_t chunk_size = max<size_t>(1, min(BATCH_CHUNK, BATCH_WINDOW / (pool.size() * TASKS_PER_THREAD)));
+        BatchWindow* solving = &windows[0];
+        BatchWindow* writing = nullptr;
+
+        while(true){
+            BatchWindow& window = *solving;
+
+            // Collect the next window of puzzle lines or records.
+            window.lines.clear();
+            window.first = result.puzzles;
+            while(packed && window.lines.size() < BATCH_WINDOW && next_record < header.count){
+                window.lines.push_back(input.data() + header.data_offset + next_record++ * header.record_size);
+            }
+            for(const char* line; window.lines.size() < BATCH_WINDOW && (line = scanner.next()) != nullptr;){
+                window.lines.push_back(line);
+            }
+            result.puzzles += window.lines.size();
+
+            size_t chunks = options.split ? 0 : (window.lines.size() + chunk_size - 1) / chunk_size;
+            window.solved.assign(chunks, 0);
+            window.exhausted.assign(chunks, 0);
+            window.stats.assign(STATS_ENABLED ? (per_puzzle ? window.lines.size() : chunks) : 0, SearchStats());
+            window.records.assign(options.portfolio.empty() ? 0 : window.lines.size(), PortfolioRecord());
+
+            for(size_t chunk = 0; chunk < chunks; chunk++){
+                pool.submit([&window, &options, &cache, chunk, chunk_size, per_puzzle, packed, solve, line_width] {
+                    size_t first = chunk * chunk_size;
+                    size_t last = min(first + chunk_size, window.lines.size());
+                    if(options.engine == Engine::sliced){
+                        solve_sliced_chunk(window, chunk, first, last, packed, options);
+                        return;
+                    }
+                    size_t count = 0;
+                    size_t exhausted = 0;
+
+                    for(size_t i = first; i < last; i++){
+                        if(STATS_ENABLED){
+                            thread_stats = SearchStats();
+                        }
+
+                        Outcome outcome = options.portfolio.empty()
+                                              ? solve(window.lines[i], packed, &window.out[i * line_width], options,
+                                                      cache.get())
+                                              : solve_portfolio_line(window.lines[i], packed,
+                                                                     &window.out[i * line_width], options,
+                                                                     window.records[i]);
+                        count += outcome == Outcome::solved;
+                        exhausted += outcome == Outcome::exhausted || outcome == Outcome::cancelled;
+
+                        if(STATS_ENABLED){
+                            thread_stats.puzzles = 1;
+                            window.stats[per_puzzle ? i : chunk].merge(thread_stats);
+                        }
+                    }
+                    window.solved[chunk] = count;
+                    window.exhausted[chunk] = exhausted;
+                });
+            }
+
+            // Write the previous window while this one is solving.
+            if(writing != nullptr){
+                output.write(writing->out.data(), writing->lines.size() * line_width);
+                for(size_t i = 0; per_puzzle && i < writing->stats.size(); i++){
+                    stats_output.write("{\"puzzle\": " + to_string(writing->first + i) + ", \"stats\": " +
+                                       writing->stats[i].json() + "}\n");
+                }
+                for(size_t i = 0; !options.portfolio_log.empty() && i < writing->records.size(); i++){
+                    portfolio_log.write(writing->records[i].json(writing->first + i, options.portfolio) + "\n");
+                }
+            }
+
+            for(size_t i = 0; options.split && i < window.lines.size(); i++){
+                result.solved += split(window.lines[i], packed, &window.out[i * line_width], pool);
+            }
+
+            pool.wait();
+
+            for(size_t count : window.solved){
+                result.solved += count;
+            }
+            for(size_t count : window.exhausted){
+                result.exhausted += count;
+            }
+            for(const SearchStats& stats : window.stats){
+                result.stats.merge(stats);
+            }
+            for(const PortfolioRecord& record : window.records){
+                if(record.winner >= 0){
+                    result.wins[record.winner]++;
+                }
+            }
+
+            if(window.lines.empty()){
+                break;
+            }
+            writing = solving;
+            solving = (solving == &windows[0]) ? &windows[1] : &windows[0];
+        }
+    }
+
+    if(!output.close() || !stats_output.close() || !portfolio_log.close()){
+        cerr << "ERROR: Failed to write the results." << endl;
+        exit(EXIT_FAILURE);
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    if(cache){
+        result.cache_hits = cache->hits();
+        result.cache_misses = cache->misses();
+    }
+
+    if(!options.stats.empty() && !write_stats(options.stats, result.stats, options.prometheus)){
+        cerr << "ERROR: Failed to open " << options.stats << " for writing." << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    return result;
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef BATCH_H
+#define BATCH_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "budget.hpp"
+#include "engine.hpp"
+#include "portfolio.hpp"
+#include "stats.hpp"
+
+using namespace std;
+
+/// @brief Settings for a non-interactive batch run.
+struct BatchOptions{
+    string input; // File with one puzzle per line (81 characters for 9x9), or a packed 9x9 container
+    string output; // File the solutions are written to, empty for standard output
+    unsigned threads = 0; // Worker threads, 0 for one per core
+    Engine engine = Engine::backtrack; // Solver engine used for every puzzle, only backtrack for sizes other than 9x9
+    Heuristic heuristic = Heuristic::first; // Branching heuristic of the backtrack engine
+    Budget budget; // Node and time limits of every puzzle, none by default
+    int box = 3; // Box size of the puzzles: 2 for 4x4, 3 for 9x9, 4 for 16x16, 5 for 25x25
+    size_t cache = 0; // Entries of the canonical solution cache, 0 for no cache (9x9 only)
+    bool split = false; // Solve the puzzles one at a time, each with every thread (see solve_parallel)
+    string stats; // File for the aggregated stats, empty for none (needs -DSUDOKU_STATS)
+    string puzzle_stats; // File for one JSON line of stats per puzzle, empty for none (needs -DSUDOKU_STATS)
+    bool prometheus = false; // Aggregated stats in the Prometheus text format instead of JSON
+    vector<Strategy> portfolio; // Strategies taking turns on every puzzle (see staged_portfolio), empty for the engine
+    string portfolio_log; // File for one JSON line per puzzle with the winning strategy and the puzzle's features
+};
+
+/// @brief Totals reported after a batch run.
+struct BatchResult{
+    size_t puzzles = 0; // Puzzle lines read
+    size_t solved = 0; // Puzzles with a solution written out
+    size_t exhausted = 0; // Puzzles given up on when their budget ran out
+    double seconds = 0; // Wall time of the run, reading and writing overlap with solving
+    uint64_t cache_hits = 0; // Puzzles answered from the solution cache
+    uint64_t cache_misses = 0;
+    SearchStats stats; // Counters merged over every puzzle, all zero without -DSUDOKU_STATS
+    vector<size_t> wins; // Puzzles won by every strategy of the portfolio, in the order of the options
+};
+
+BatchResult solve_batch(const BatchOptions& options); // Solves every puzzle in the input file and writes them out in order
+
+#endif
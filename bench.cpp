@@ -0,0 +1,385 @@
+// The benchmark reads the search node counters, so it always builds with them.
+#define SUDOKU_STATS
+#include "stats.cpp"
+#include "grid.cpp"
+#include "propagate.cpp"
+#include "count.cpp"
+#include "heuristic.cpp"
+#include "dlx.cpp"
+#include "sliced.cpp"
+#include "engine.cpp"
+#include "thread_pool.cpp"
+#include "parallel.cpp"
+#include "io.cpp"
+#include "grade.cpp"
+#include "generator.cpp"
+#include "budget.cpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*                                     Benchmark over the bundled corpora for every engine                                     */
+
+/// @brief A named set of puzzles.
+struct Corpus{
+    string name;
+    vector<Grid> puzzles;
+};
+
+/// @brief Results of one corpus, engine, heuristic and thread count.
+struct Report{
+    string corpus;
+    string engine;
+    string heuristic; // Branching heuristic of the backtrack engine, "-" for dlx and sliced
+    unsigned threads = 0;
+    size_t puzzles = 0; // Puzzles solved in the run, the corpus size times the repeat count
+    size_t failed = 0; // Puzzles with no solution or a wrong one
+    double seconds = 0;
+    double rate = 0; // Puzzles per second
+    double mean_us = 0;
+    double p50_us = 0;
+    double p99_us = 0;
+    double max_us = 0;
+    double nodes = 0; // Mean search nodes per puzzle
+};
+
+/// @brief Settings from the command line.
+struct BenchOptions{
+    string corpus_dir = "corpora";
+    vector<Engine> engines = {Engine::backtrack, Engine::dlx, Engine::sliced};
+    vector<Heuristic> heuristics = {Heuristic::first}; // Run with the backtrack engine, the others ignore them
+    vector<unsigned> threads = {1};
+    size_t generated = 1000; // Size of the generated corpus, 0 to skip it
+    uint64_t seed = 1;
+    int repeat = 1;
+    string json; // File for the machine-readable results, empty for none
+};
+
+/// @brief Reads a corpus file, one 81-character puzzle per line, '#' lines are comments and empty lines are skipped.
+///         Any other line must be a valid puzzle, so a damaged corpus cannot silently shrink the benchmark.
+/// @return False with the error printed if the file cannot be opened or a line is not a puzzle.
+static bool load_corpus(const string& path, const string& name, Corpus& corpus){
+
+    ifstream File(path);
+    if(!File.is_open()){
+        cerr << "ERROR: Failed to open " << path << "." << endl;
+        return false;
+    }
+
+    corpus.name = name;
+    string line;
+    for(int number = 1; getline(File, line); number++){
+        if(!line.empty() && line.back() == '\r'){
+            line.pop_back();
+        }
+        if(line.empty() || line[0] == '#'){
+            continue;
+        }
+
+        Grid grid;
+        if(line.size() != 81 || !grid.parse(line.c_str())){
+            cerr << "ERROR: " << path << ":" << number << " is not a puzzle: expected 81 cells of 1-9, '.' or '0' "
+                 << "without a repeated digit, got " << line.size() << " characters." << endl;
+            return false;
+        }
+        corpus.puzzles.push_back(grid);
+    }
+    return true;
+}
+
+/// @brief Checks that a solved grid is complete and keeps every given of the puzzle.
+static bool check_solution(const Grid& puzzle, const Grid& solution){
+    for(int cell = 0; cell < 81; cell++){
+        if(solution.get(cell) == 0 || (puzzle.get(cell) != 0 && puzzle.get(cell) != solution.get(cell))){
+            return false;
+        }
+    }
+    return true; // The masks of Grid never let a digit repeat, a full grid is a valid one.
+}
+
+/// @brief Returns the value at a percentile of sorted samples (nearest rank).
+static double percentile(const vector<double>& sorted, double fraction){
+    if(sorted.empty()){
+        return 0;
+    }
+    size_t rank = (size_t)(fraction * sorted.size());
+    return sorted[min(rank, sorted.size() - 1)];
+}
+
+/// @brief Solves a corpus with one engine and heuristic on a pool of the given size, timing every puzzle on its own.
+///         The sliced engine solves the 64 puzzles of a task as one group instead, and every puzzle of the group is
+///         charged the time and the mean search nodes of the whole group.
+static Report run_case(const Corpus& corpus, Engine engine, Heuristic heuristic, unsigned threads, int repeat){
+
+    size_t total = corpus.puzzles.size() * repeat;
+    vector<double> latency(total);
+    vector<uint64_t> nodes(total);
+    vector<char> failed(total, 0);
+
+    auto start = chrono::steady_clock::now();
+    {
+        ThreadPool pool(threads);
+        size_t chunk = engine == Engine::sliced ? 64 : max<size_t>(1, min<size_t>(64, total / (pool.size() * 16)));
+
+        for(size_t first = 0; first < total; first += chunk){
+            pool.submit([&, first] {
+                size_t last = min(first + chunk, total);
+
+                if(engine == Engine::sliced){
+                    Grid grids[64];
+                    bool solved[64];
+                    for(size_t i = first; i < last; i++){
+                        grids[i - first] = corpus.puzzles[i % corpus.puzzles.size()];
+                    }
+
+                    uint64_t nodes_before = thread_stats.nodes;
+                    auto begin = chrono::steady_clock::now();
+                    solve_sliced(grids, last - first, solved);
+                    auto end = chrono::steady_clock::now();
+
+                    for(size_t i = first; i < last; i++){
+                        latency[i] = chrono::duration<double, micro>(end - begin).count();
+                        nodes[i] = (thread_stats.nodes - nodes_before) / (last - first);
+                        failed[i] = !solved[i - first] ||
+                                    !check_solution(corpus.puzzles[i % corpus.puzzles.size()], grids[i - first]);
+                    }
+                    return;
+                }
+
+                for(size_t i = first; i < last; i++){
+                    const Grid& puzzle = corpus.puzzles[i % corpus.puzzles.size()];
+                    Grid grid = puzzle;
+
+                    uint64_t nodes_before = thread_stats.nodes;
+                    auto begin = chrono::steady_clock::now();
+                    bool solved = solve_grid(grid, engine, heuristic);
+                    auto end = chrono::steady_clock::now();
+
+                    latency[i] = chrono::duration<double, micro>(end - begin).count();
+                    nodes[i] = thread_stats.nodes - nodes_before;
+                    failed[i] = !solved || !check_solution(puzzle, grid);
+                }
+            });
+        }
+        pool.wait();
+    }
+
+    Report report;
+    report.corpus = corpus.name;
+    report.engine = engine_name(engine);
+    report.heuristic = engine == Engine::backtrack ? heuristic_name(heuristic) : "-";
+    report.threads = threads;
+    report.puzzles = total;
+    report.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    report.rate = report.seconds > 0 ? total / report.seconds : 0;
+
+    double latency_sum = 0;
+    double nodes_sum = 0;
+    for(size_t i = 0; i < total; i++){
+        latency_sum += latency[i];
+        nodes_sum += nodes[i];
+        report.failed += failed[i];
+    }
+    sort(latency.begin(), latency.end());
+
+    report.mean_us = total ? latency_sum / total : 0;
+    report.p50_us = percentile(latency, 0.50);
+    report.p99_us = percentile(latency, 0.99);
+    report.max_us = latency.empty() ? 0 : latency.back();
+    report.nodes = total ? nodes_sum / total : 0;
+    return report;
+}
+
+/// @brief Writes the reports as a JSON array.
+static void write_json(ostream& out, const vector<Report>& reports){
+    out << "[" << endl;
+    for(size_t i = 0; i < reports.size(); i++){
+        const Report& r = reports[i];
+        out << "  {\"corpus\": \"" << r.corpus << "\", \"engine\": \"" << r.engine << "\", \"heuristic\": \"" << r.heuristic
+            << "\", \"threads\": " << r.threads
+            << ", \"kernel\": \"" << Propagator::kernel() << "\", \"sliced_kernel\": \"" << sliced_kernel()
+            << "\", \"puzzles\": " << r.puzzles
+            << ", \"failed\": " << r.failed << ", \"seconds\": " << r.seconds << ", \"puzzles_per_sec\": " << r.rate
+            << ", \"latency_us\": {\"mean\": " << r.mean_us << ", \"p50\": " << r.p50_us << ", \"p99\": " << r.p99_us
+            << ", \"max\": " << r.max_us << "}, \"nodes_per_puzzle\": " << r.nodes << "}"
+            << (i + 1 < reports.size() ? "," : "") << endl;
+    }
+    out << "]" << endl;
+}
+
+/// @brief Splits a comma separated option value.
+static vector<string> split_list(const string& value){
+    vector<string> items;
+    stringstream stream(value);
+    string item;
+    while(getline(stream, item, ',')){
+        if(!item.empty()){
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+static void print_usage(ostream& out){
+    out << "Usage: bench [options]" << endl;
+    out << "  --corpus DIR       directory with easy.txt, hard.txt and 17clue.txt (default corpora)" << endl;
+    out << "  --engines LIST     comma separated engines (default backtrack,dlx,sliced)" << endl;
+    out << "  --heuristics LIST  comma separated heuristics of the backtrack engine (default first)" << endl;
+    out << "  --threads LIST     comma separated thread counts (default 1)" << endl;
+    out << "  --generated N      size of the generated corpus, 0 to skip it (default 1000)" << endl;
+    out << "  --seed S           seed of the generated corpus (default 1)" << endl;
+    out << "  --repeat R         solve every corpus R times per case (default 1)" << endl;
+    out << "  --json FILE        also write the results as JSON" << endl;
+    out << "  --sliced-kernel K  kernel of the sliced engine: avx512, avx2, scalar or auto (default)" << endl;
+}
+
+/// @brief Parses the command line into the options, exits with an error on bad input.
+static BenchOptions parse_options(int argc, char* argv[]){
+
+    BenchOptions options;
+
+    for(int i = 1; i < argc; i++){
+        string arg = argv[i];
+
+        if(arg == "--help" || arg == "-h"){
+            print_usage(cout);
+            exit(EXIT_SUCCESS);
+        }
+        if(i + 1 >= argc){
+            cerr << "ERROR: Unknown option or missing value: " << arg << "." << endl;
+            print_usage(cerr);
+            exit(EXIT_FAILURE);
+        }
+        string value = argv[++i];
+
+        if(arg == "--corpus"){
+            options.corpus_dir = value;
+        }
+        else if(arg == "--engines"){
+            options.engines.clear();
+            for(const string& name : split_list(value)){
+                Engine engine;
+                if(!parse_engine(name, engine)){
+                    cerr << "ERROR: Unknown engine " << name << "." << endl;
+                    exit(EXIT_FAILURE);
+                }
+                options.engines.push_back(engine);
+            }
+        }
+        else if(arg == "--heuristics"){
+            options.heuristics.clear();
+            for(const string& name : split_list(value)){
+                Heuristic heuristic;
+                if(!parse_heuristic(name, heuristic)){
+                    cerr << "ERROR: Unknown heuristic " << name << "." << endl;
+                    exit(EXIT_FAILURE);
+                }
+                options.heuristics.push_back(heuristic);
+            }
+        }
+        else if(arg == "--threads"){
+            options.threads.clear();
+            for(const string& count : split_list(value)){
+                options.threads.push_back(stoul(count));
+            }
+        }
+        else if(arg == "--generated"){
+            options.generated = stoul(value);
+        }
+        else if(arg == "--seed"){
+            options.seed = stoull(value);
+        }
+        else if(arg == "--repeat"){
+            options.repeat = max(1, stoi(value));
+        }
+        else if(arg == "--json"){
+            options.json = value;
+        }
+        else if(arg == "--sliced-kernel"){
+            if(!select_sliced_kernel(value)){
+                cerr << "ERROR: Sliced kernel " << value << " is unknown or not supported on this CPU." << endl;
+                exit(EXIT_FAILURE);
+            }
+        }
+        else{
+            cerr << "ERROR: Unknown option " << arg << "." << endl;
+            print_usage(cerr);
+            exit(EXIT_FAILURE);
+        }
+    }
+    return options;
+}
+
+int main(int argc, char* argv[]) {
+
+    BenchOptions options = parse_options(argc, argv);
+
+    // Load the bundled corpora, then generate the last one from the seed.
+    vector<Corpus> corpora;
+    for(const char* name : {"easy", "hard", "17clue"}){
+        Corpus corpus;
+        if(!load_corpus(options.corpus_dir + "/" + name + ".txt", name, corpus)){
+            return EXIT_FAILURE;
+        }
+        corpora.push_back(corpus);
+    }
+    if(options.generated > 0){
+        Corpus corpus;
+        corpus.name = "generated";
+        corpus.puzzles.resize(options.generated);
+
+        Rng rng;
+        for(size_t i = 0; i < options.generated; i++){
+            rng.reseed(options.seed ^ (i * 0xD1B54A32D192ED03ULL));
+            generate_puzzle(rng, corpus.puzzles[i]);
+        }
+        corpora.push_back(corpus);
+    }
+
+    cout << "propagation kernel: " << Propagator::kernel() << endl;
+    cout << "sliced kernel: " << sliced_kernel() << " (" << sliced_width() << " boards per step)" << endl << endl;
+    cout << left << setw(10) << "corpus" << setw(11) << "engine" << setw(10) << "heuristic" << right << setw(8) << "threads" << setw(9) << "puzzles"
+         << setw(13) << "puzzles/s" << setw(11) << "mean us" << setw(11) << "p50 us" << setw(11) << "p99 us"
+         << setw(11) << "max us" << setw(11) << "nodes" << setw(8) << "failed" << endl;
+
+    vector<Report> reports;
+    for(const Corpus& corpus : corpora){
+        for(Engine engine : options.engines){
+            for(size_t h = 0; h < options.heuristics.size() && (h == 0 || engine == Engine::backtrack); h++){
+                for(unsigned threads : options.threads){
+                    Report r = run_case(corpus, engine, options.heuristics[h], threads, options.repeat);
+                    reports.push_back(r);
+
+                    cout << left << setw(10) << r.corpus << setw(11) << r.engine << setw(10) << r.heuristic << right
+                         << setw(8) << r.threads << setw(9) << r.puzzles << fixed << setprecision(0) << setw(13)
+                         << r.rate << setprecision(1) << setw(11) << r.mean_us << setw(11) << r.p50_us << setw(11)
+                         << r.p99_us << setw(11) << r.max_us << setw(11) << r.nodes << setw(8) << r.failed
+                         << defaultfloat << endl;
+                }
+            }
+        }
+    }
+
+    if(!options.json.empty()){
+        ofstream File(options.json);
+        if(!File.is_open()){
+            cerr << "ERROR: Failed to open " << options.json << " for writing." << endl;
+            return EXIT_FAILURE;
+        }
+        write_json(File, reports);
+    }
+
+    size_t failed = 0;
+    for(const Report& r : reports){
+        failed += r.failed;
+    }
+    return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
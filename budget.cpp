@@ -0,0 +1,165 @@
+#ifndef BUDGET_CPP
+#define BUDGET_CPP
+#include "budget.hpp"
+#include "count.hpp"
+#include "generator.hpp"
+#include "rng.hpp"
+
+/// @brief Returns the name of an outcome.
+const char* outcome_name(Outcome outcome){
+    switch(outcome){
+        case Outcome::solved: return "solved";
+        case Outcome::unsolvable: return "unsolvable";
+        case Outcome::exhausted: return "exhausted";
+        case Outcome::cancelled: return "cancelled";
+    }
+    return "unknown";
+}
+
+/// @brief Constructor for the BudgetScope class. The clock starts now. A token that is already cancelled stops the
+///         call before its first node.
+/// @param budget The limits, copied.
+BudgetScope::BudgetScope(const Budget& budget) : token(budget.cancel), previous(thread_budget){
+
+    node_limit = budget.nodes > 0 ? budget.nodes : UINT64_MAX;
+    deadline = budget.seconds > 0 ? chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(
+                                        chrono::duration<double>(budget.seconds))
+                                  : chrono::steady_clock::time_point::max();
+    thread_budget = this;
+    check();
+}
+
+/// @brief Destructor for the BudgetScope class, the enclosing budget applies again.
+BudgetScope::~BudgetScope(){
+    thread_budget = previous;
+}
+
+/// @brief Reads the token and the clock.
+/// @return False if the call has to stop.
+bool BudgetScope::check(){
+    if(token && token->cancelled()){
+        stop(Outcome::cancelled);
+    }
+    else if(chrono::steady_clock::now() >= deadline){
+        stop(Outcome::exhausted);
+    }
+    return running;
+}
+
+void BudgetScope::stop(Outcome why){
+    if(running){
+        running = false;
+        reason = why;
+    }
+}
+
+/// @brief Runs one bounded call: installs the budget, gives the call counters of its own, and fills in the outcome,
+///         the node count, the time and the stats. The thread's own counters get the call's added back afterwards.
+/// @param budget The limits of the call.
+/// @param result Receives everything but the grid and the count.
+/// @param call Runs the search, returns true if it finished with a solution.
+template<int Box, typename Call>
+static void run_bounded(const Budget& budget, BoundedResult<Box>& result, Call call){
+
+    SearchStats outer = thread_stats;
+    thread_stats = SearchStats();
+    auto start = chrono::steady_clock::now();
+    {
+        BudgetScope scope(budget);
+        bool finished = !scope.stopped() && call();
+
+        if(scope.stopped()){
+            result.outcome = scope.stop_reason();
+        }
+        else{
+            result.outcome = finished ? Outcome::solved : Outcome::unsolvable;
+        }
+        result.nodes = scope.nodes();
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    result.stats = thread_stats;
+    thread_stats = outer;
+    thread_stats.merge(result.stats);
+}
+
+/// @brief Solves a puzzle within a budget.
+/// @param puzzle The puzzle, must have consistent givens.
+/// @param budget The node, time and cancellation limits.
+/// @param engine The engine, Dancing Links only on 9x9.
+/// @param heuristic The branching heuristic of the backtrack engine.
+/// @return solved with the solution in grid, unsolvable, or exhausted/cancelled with the puzzle in grid as given.
+template<int Box>
+BoundedResult<Box> solve_bounded(const BasicGrid<Box>& puzzle, const Budget& budget, Engine engine, Heuristic heuristic){
+
+    BoundedResult<Box> result;
+    result.grid = puzzle;
+    run_bounded(budget, result, [&] {
+        if constexpr(Box == 3){
+            return solve_grid(result.grid, engine, heuristic);
+        }
+        else{
+            return solve_heuristic(result.grid, heuristic);
+        }
+    });
+    return result;
+}
+
+/// @brief Counts the solutions of a puzzle within a budget.
+/// @param puzzle The puzzle, it is not changed.
+/// @param limit Counting stops at this many solutions.
+/// @param budget The node, time and cancellation limits.
+/// @return solved with the count (at most limit) in count; on exhausted/cancelled, count holds the solutions found
+///         before the stop.
+template<int Box>
+BoundedResult<Box> count_bounded(const BasicGrid<Box>& puzzle, int limit, const Budget& budget){
+
+    BoundedResult<Box> result;
+    result.grid = puzzle;
+    run_bounded(budget, result, [&] {
+        result.count = count_solutions(puzzle, limit);
+        return true;
+    });
+    return result;
+}
+
+/// @brief Generates a puzzle within a budget, the one --generate makes first from the same seed.
+/// @param seed The seed.
+/// @param budget The node, time and cancellation limits, for every search the generator makes.
+/// @return solved with the puzzle in grid, or exhausted/cancelled with an unfinished grid.
+template<int Box>
+BoundedResult<Box> generate_bounded(uint64_t seed, const Budget& budget){
+
+    BoundedResult<Box> result;
+    run_bounded(budget, result, [&] {
+        Rng rng(seed);
+        generate_puzzle(rng, result.grid);
+        return true;
+    });
+    return result;
+}
+
+/// @brief Starts solve_bounded on a thread of its own.
+template<int Box>
+future<BoundedResult<Box>> solve_async(const BasicGrid<Box>& puzzle, Budget budget, Engine engine, Heuristic heuristic){
+    return async(launch::async, [puzzle, budget, engine, heuristic] {
+        return solve_bounded(puzzle, budget, engine, heuristic);
+    });
+}
+
+/// @brief Starts count_bounded on a thread of its own.
+template<int Box>
+future<BoundedResult<Box>> count_async(const BasicGrid<Box>& puzzle, int limit, Budget budget){
+    return async(launch::async, [puzzle, limit, budget] {
+        return count_bounded(puzzle, limit, budget);
+    });
+}
+
+/// @brief Starts generate_bounded on a thread of its own.
+template<int Box>
+future<BoundedResult<Box>> generate_async(uint64_t seed, Budget budget){
+    return async(launch::async, [seed, budget] {
+        return generate_bounded<Box>(seed, budget);
+    });
+}
+
+#endif
@@ -0,0 +1,129 @@
+#ifndef BUDGET_H
+#define BUDGET_H
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include "engine.hpp"
+#include "grid.hpp"
+#include "heuristic.hpp"
+#include "stats.hpp"
+
+using namespace std;
+
+/// @brief Flag a caller sets to stop a running call from another thread.
+class CancelToken{
+    public:
+        void cancel() { flag.store(true, memory_order_relaxed); }
+        bool cancelled() const { return flag.load(memory_order_relaxed); }
+
+    private:
+        atomic<bool> flag{false};
+};
+
+/// @brief Limits of one solve, count or generate call. All of them are optional.
+struct Budget{
+    uint64_t nodes = 0; // Most search nodes, 0 for no limit
+    double seconds = 0; // Wall-clock limit from the start of the call, 0 for none
+    shared_ptr<const CancelToken> cancel; // Stops the call once cancelled, nullptr for none
+
+    bool limited() const { return nodes > 0 || seconds > 0 || cancel != nullptr; }
+};
+
+/// @brief How a bounded call ended.
+enum class Outcome{
+    solved, // Finished: a solution was found, the count is exact, or the puzzle was generated
+    unsolvable, // Finished without a solution
+    exhausted, // The node budget or the deadline ran out first
+    cancelled // The cancellation token was set
+};
+
+const char* outcome_name(Outcome outcome); // "solved", "unsolvable", "exhausted" or "cancelled"
+
+/// @brief The budget of the call running on the calling thread. The searches count every node with budget_node, which
+///         reads the clock and the token only every CHECK_INTERVAL nodes. Once the budget is spent every node fails,
+///         so the search unwinds as if no branch had a solution and undoes its placements on the way.
+///         Scopes nest; the inner one replaces the outer one until it ends.
+class BudgetScope{
+    public:
+
+        static const uint64_t CHECK_INTERVAL = 1024; // Nodes between two reads of the clock and the token
+
+        explicit BudgetScope(const Budget& budget); // Installs the budget on the calling thread
+        ~BudgetScope(); // Puts the previous budget back
+        BudgetScope(const BudgetScope&) = delete;
+        BudgetScope& operator=(const BudgetScope&) = delete;
+
+        /// @brief Counts a node. Returns false once the budget is spent.
+        bool spend(){
+            if(!running){
+                return false;
+            }
+            if(++node_count > node_limit){
+                stop(Outcome::exhausted);
+                return false;
+            }
+            return (node_count & (CHECK_INTERVAL - 1)) != 0 || check();
+        }
+
+        bool stopped() const { return !running; }
+        Outcome stop_reason() const { return reason; } // exhausted or cancelled once stopped
+        uint64_t nodes() const { return node_count; }
+
+    private:
+        bool check(); // Reads the token and the clock, stops and returns false if either says so
+        void stop(Outcome why);
+
+        uint64_t node_count = 0;
+        uint64_t node_limit;
+        chrono::steady_clock::time_point deadline;
+        shared_ptr<const CancelToken> token; // nullptr for none
+        bool running = true;
+        Outcome reason = Outcome::exhausted;
+        BudgetScope* previous;
+};
+
+inline thread_local BudgetScope* thread_budget = nullptr; // Budget of the calling thread, nullptr for none
+
+/// @brief Counts a search node against the budget of the calling thread, if there is one.
+/// @return False once the budget is spent, the search must then fail the node.
+inline bool budget_node(){
+    return thread_budget == nullptr || thread_budget->spend();
+}
+
+/// @brief Tells if the budget of the calling thread is spent.
+inline bool budget_stopped(){
+    return thread_budget != nullptr && thread_budget->stopped();
+}
+
+/// @brief Result of a bounded call, with the statistics gathered up to where it ended.
+template<int Box>
+struct BoundedResult{
+    Outcome outcome = Outcome::unsolvable;
+    BasicGrid<Box> grid; // The solution or the generated puzzle when solved, otherwise the puzzle as given
+    int count = 0; // For count calls: the solutions found, a lower bound unless the outcome is solved
+    uint64_t nodes = 0; // Search nodes visited, counted whether or not stats are compiled in
+    double seconds = 0;
+    SearchStats stats; // Counters of the call, all zero without -DSUDOKU_STATS
+};
+
+template<int Box>
+BoundedResult<Box> solve_bounded(const BasicGrid<Box>& puzzle, const Budget& budget, Engine engine = Engine::backtrack,
+                                 Heuristic heuristic = Heuristic::first); // dlx only for 9x9
+template<int Box>
+BoundedResult<Box> count_bounded(const BasicGrid<Box>& puzzle, int limit, const Budget& budget);
+template<int Box>
+BoundedResult<Box> generate_bounded(uint64_t seed, const Budget& budget); // The puzzle --generate makes from seed
+
+// The same calls on a thread of their own. Wait on the future with a timeout and cancel the token of the budget to
+// enforce a deadline from the outside; the call returns at its next clock check.
+template<int Box>
+future<BoundedResult<Box>> solve_async(const BasicGrid<Box>& puzzle, Budget budget, Engine engine = Engine::backtrack,
+                                       Heuristic heuristic = Heuristic::first);
+template<int Box>
+future<BoundedResult<Box>> count_async(const BasicGrid<Box>& puzzle, int limit, Budget budget);
+template<int Box>
+future<BoundedResult<Box>> generate_async(uint64_t seed, Budget budget);
+
+#endif
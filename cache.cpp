@@ -0,0 +1,124 @@
+#ifndef CACHE_CPP
+#define CACHE_CPP
+#include "cache.hpp"
+#include "budget.hpp"
+#include "canon.hpp"
+#include <algorithm>
+#include <functional>
+
+static const int CACHE_MIN_GIVENS = 17; // Fewer givens never make a unique puzzle and are the slowest to canonicalize
+
+/// @brief Constructor for the SolutionCache class.
+/// @param capacity The most entries kept over all shards, at least one per shard.
+/// @param shard_count The number of independently locked shards.
+SolutionCache::SolutionCache(size_t capacity, size_t shard_count) : hit_count(0), miss_count(0){
+
+    shard_count = max<size_t>(1, min(shard_count, capacity));
+    for(size_t i = 0; i < shard_count; i++){
+        shards.push_back(make_unique<Shard>());
+        shards.back()->capacity = max<size_t>(1, capacity / shard_count);
+    }
+}
+
+/// @brief Returns the shard a key belongs to.
+SolutionCache::Shard& SolutionCache::shard_of(const string& key){
+    return *shards[hash<string>()(key) % shards.size()];
+}
+
+/// @brief Looks a puzzle up.
+/// @param key The canonical puzzle.
+/// @param solution Receives the canonical solution, empty if the puzzle is known to have none.
+/// @return True on a hit.
+bool SolutionCache::find(const string& key, string& solution){
+
+    Shard& shard = shard_of(key);
+    lock_guard<mutex> guard(shard.lock);
+
+    auto found = shard.index.find(key);
+    if(found == shard.index.end()){
+        miss_count++;
+        return false;
+    }
+    shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+    solution = found->second->second;
+    hit_count++;
+    return true;
+}
+
+/// @brief Adds a solved puzzle. An existing entry is refreshed, a full shard drops its least recently used entry.
+/// @param key The canonical puzzle.
+/// @param solution The canonical solution, empty if the puzzle has none.
+void SolutionCache::insert(const string& key, const string& solution){
+
+    Shard& shard = shard_of(key);
+    lock_guard<mutex> guard(shard.lock);
+
+    auto found = shard.index.find(key);
+    if(found != shard.index.end()){
+        found->second->second = solution;
+        shard.entries.splice(shard.entries.begin(), shard.entries, found->second);
+        return;
+    }
+
+    if(shard.entries.size() >= shard.capacity){
+        shard.index.erase(shard.entries.back().first);
+        shard.entries.pop_back();
+    }
+    shard.entries.emplace_front(key, solution);
+    shard.index[key] = shard.entries.begin();
+}
+
+/// @brief Solves a grid through the cache. The puzzle is canonicalized; on a hit the stored solution is mapped back
+///         through the inverse transform, on a miss the engine solves it and the solution is stored in canonical form,
+///         so every puzzle isomorphic to it hits from then on. Puzzles without a solution are stored as well.
+///         A puzzle with several solutions may get a different one of them than the engine alone would return.
+/// @param grid The puzzle, must have consistent givens. Receives the solution.
+/// @param engine The engine that solves the misses.
+/// @param cache The cache.
+/// @param heuristic The branching heuristic of the backtrack engine.
+/// @return True if a solution was found, otherwise false and the grid is left as it was.
+bool solve_cached(Grid& grid, Engine engine, SolutionCache& cache, Heuristic heuristic){
+
+    int givens = 0;
+    for(int cell = 0; cell < 81; cell++){
+        givens += grid.get(cell) != 0;
+    }
+    if(givens < CACHE_MIN_GIVENS){
+        return solve_grid(grid, engine, heuristic);
+    }
+
+    uint8_t canon[81];
+    uint8_t solution[81];
+    Transform transform;
+    canonicalize(grid, canon, transform);
+    string key((const char*)canon, 81);
+    string value;
+
+    if(cache.find(key, value)){
+        if(value.empty()){
+            return false;
+        }
+        invert_transform(transform, (const uint8_t*)value.data(), solution);
+        for(int cell = 0; cell < 81; cell++){
+            if(grid.get(cell) == 0){
+                grid.place(cell, solution[cell]);
+            }
+        }
+        return true;
+    }
+
+    if(!solve_grid(grid, engine, heuristic)){
+        if(!budget_stopped()){
+            cache.insert(key, string()); // A search cut short by its budget proves nothing.
+        }
+        return false;
+    }
+    for(int cell = 0; cell < 81; cell++){
+        solution[cell] = grid.get(cell);
+    }
+    apply_transform(transform, solution, canon);
+    cache.insert(key, string((const char*)canon, 81));
+    return true;
+}
+
+#endif
@@ -0,0 +1,53 @@
+#ifndef CACHE_H
+#define CACHE_H
+#include "engine.hpp"
+#include "grid.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/// @brief Bounded least-recently-used map from a canonical puzzle to its canonical solution, shared by every thread.
+///         The entries are spread over shards by the hash of the key and every shard has its own lock, list and index,
+///         so threads only contend when they hit the same shard. Each shard evicts its own least recently used entry
+///         once it holds its share of the capacity.
+class SolutionCache{
+    public:
+
+        explicit SolutionCache(size_t capacity, size_t shard_count = 64); // Constructor, capacity in entries
+
+        bool find(const string& key, string& solution); // Copies the solution out and marks the entry as recently used
+        void insert(const string& key, const string& solution); // Adds or refreshes an entry, evicting if full
+
+        uint64_t hits() const { return hit_count; }
+        uint64_t misses() const { return miss_count; }
+
+    private:
+        using Entry = pair<string, string>;
+
+        struct Shard{
+            mutex lock;
+            list<Entry> entries; // Most recently used first
+            unordered_map<string, list<Entry>::iterator> index;
+            size_t capacity = 1;
+        };
+
+        Shard& shard_of(const string& key);
+
+        vector<unique_ptr<Shard>> shards;
+        atomic<uint64_t> hit_count;
+        atomic<uint64_t> miss_count;
+};
+
+// solve_grid behind the cache, same contract
+bool solve_cached(Grid& grid, Engine engine, SolutionCache& cache, Heuristic heuristic = Heuristic::first);
+
+#endif
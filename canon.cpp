@@ -0,0 +1,338 @@
+#ifndef CANON_CPP
+#define CANON_CPP
+#include "canon.hpp"
+#include <algorithm>
+#include <cstring>
+
+// The six orders of three things, used for the bands, the stacks and the rows or columns inside one of them.
+static const uint8_t ORDERS[6][3] = {{0, 1, 2}, {0, 2, 1}, {1, 0, 2}, {1, 2, 0}, {2, 0, 1}, {2, 1, 0}};
+
+/// @brief State of one canonicalization. Boards are ordered by their pattern of givens first and by their relabeled
+///         digits second; the canonical form is the smallest board in that order.
+///
+///         The pattern is compared stack by stack: the givens of the first output stack in all nine rows, then those of
+///         the second stack, then the third. The source stack and column order picked for output stack k then decide
+///         the next 27 bits of the pattern on their own (the rows are sorted inside their bands and the bands sorted,
+///         both on the stacks picked so far), so the first stage builds the column permutation one stack at a time
+///         and only extends the choices that tie for the smallest bits. Only the column permutations that reach the
+///         smallest pattern go on to the second stage, which builds the rows one at a time with their digits relabeled
+///         in order of appearance and drops any branch whose prefix is larger than the best board so far.
+class Canonicalizer{
+    public:
+
+        void run(const Grid& grid, uint8_t canon[81], Transform& transform);
+
+    private:
+        struct Choice{
+            uint8_t side; // 1 for the transposed source
+            uint8_t stacks[3]; // Source stack of each output stack
+            uint8_t orders[3]; // Column order inside it, an index into ORDERS
+        };
+
+        void pattern_key(const Choice& choice, int count, uint8_t* key, uint16_t* sequence) const;
+        void find_pattern();
+        void search(int level, int band, uint16_t used, const uint8_t* labels, int next_label);
+
+        uint8_t sources[2][81]; // The puzzle as it is and transposed
+        uint8_t stack_masks[2][9][3][6]; // Givens of every row in every stack, for each order of the stack's columns
+
+        uint16_t pattern[9]; // Row masks of the smallest pattern, the first output row first
+        Choice candidates[2 * 1296]; // Column permutations that reach the pattern
+        int candidate_count = 0;
+
+        const uint8_t* source; // Source of the candidate under test
+        uint8_t columns[9]; // Column permutation of the candidate under test
+        uint16_t masks[9]; // Row masks of the source under that permutation
+        uint8_t path[9]; // Rows picked so far
+        bool transpose;
+
+        uint8_t best[81];
+        Transform best_transform;
+};
+
+/// @brief Computes the pattern bits decided by the first count output stacks of a choice.
+/// @param choice The transposition, and the source stack and column order of the output stacks.
+/// @param count The number of output stacks to use, 1 to 3.
+/// @param key Receives count * 9 values: the 3-bit masks of the first output stack in the nine output rows, then the
+///         second stack and so on. Bit 2 of a mask is the first column of the stack.
+/// @param sequence Receives the masks of the output rows over the count stacks, the earlier stacks in the higher bits.
+void Canonicalizer::pattern_key(const Choice& choice, int count, uint8_t* key, uint16_t* sequence) const{
+
+    const uint8_t (*rows)[3][6] = stack_masks[choice.side];
+    uint16_t row_masks[9];
+    for(int row = 0; row < 9; row++){
+        row_masks[row] = 0;
+        for(int k = 0; k < count; k++){
+            row_masks[row] = (row_masks[row] << 3) | rows[row][choice.stacks[k]][choice.orders[k]];
+        }
+    }
+    auto part = [&](int k, int row) { return (row_masks[row] >> (3 * (count - 1 - k))) & 7; };
+
+    // Sort the rows inside every band, then the bands on their stacks in order.
+    uint8_t order[9] = {0, 1, 2, 3, 4, 5, 6, 7, 8};
+    for(int band = 0; band < 9; band += 3){
+        sort(order + band, order + band + 3, [&](int a, int b) { return row_masks[a] < row_masks[b]; });
+    }
+    int bands[3] = {0, 1, 2};
+    sort(bands, bands + 3, [&](int a, int b){
+        for(int k = 0; k < count; k++){
+            for(int i = 0; i < 3; i++){
+                int x = part(k, order[a * 3 + i]);
+                int y = part(k, order[b * 3 + i]);
+                if(x != y){
+                    return x < y;
+                }
+            }
+        }
+        return false;
+    });
+
+    for(int i = 0; i < 9; i++){
+        int row = order[bands[i / 3] * 3 + i % 3];
+        sequence[i] = row_masks[row];
+        for(int k = 0; k < count; k++){
+            key[k * 9 + i] = part(k, row);
+        }
+    }
+}
+
+/// @brief First stage: finds the smallest pattern and every transposition and column permutation that reaches it.
+void Canonicalizer::find_pattern(){
+
+    Choice lists[2][2 * 1296];
+    Choice* current = lists[0];
+    Choice* next = lists[1];
+    int current_count = 2;
+
+    current[0] = Choice{0, {0, 0, 0}, {0, 0, 0}};
+    current[1] = Choice{1, {0, 0, 0}, {0, 0, 0}};
+
+    for(int count = 1; count <= 3; count++){
+        uint8_t best_key[27];
+        int next_count = 0;
+        fill(best_key, best_key + 27, 0xFF);
+
+        for(int c = 0; c < current_count; c++){
+            for(int stack = 0; stack < 3; stack++){
+                bool used = false;
+                for(int k = 0; k < count - 1; k++){
+                    used |= current[c].stacks[k] == stack;
+                }
+                if(used){
+                    continue;
+                }
+
+                for(int order = 0; order < 6; order++){
+                    Choice choice = current[c];
+                    choice.stacks[count - 1] = stack;
+                    choice.orders[count - 1] = order;
+
+                    uint8_t key[27];
+                    uint16_t sequence[9];
+                    pattern_key(choice, count, key, sequence);
+
+                    int compare = memcmp(key, best_key, count * 9);
+                    if(compare > 0){
+                        continue;
+                    }
+                    if(compare < 0){
+                        memcpy(best_key, key, count * 9);
+                        copy(sequence, sequence + 9, pattern);
+                        next_count = 0;
+                    }
+                    next[next_count++] = choice;
+                }
+            }
+        }
+        swap(current, next);
+        current_count = next_count;
+    }
+
+    candidate_count = current_count;
+    copy(current, current + current_count, candidates);
+}
+
+/// @brief Picks the source row for output row level, bands first and then the rows inside the band. Only rows whose
+///         mask matches the pattern at that level are tried, so every branch reaches a full board.
+/// @param level The output row being filled.
+/// @param band The source band of the current output band, used inside a band.
+/// @param used The source rows taken so far, one bit each.
+/// @param labels The label given to each source digit so far, 0 if it has not appeared yet.
+/// @param next_label The number of labels handed out so far.
+void Canonicalizer::search(int level, int band, uint16_t used, const uint8_t* labels, int next_label){
+
+    uint8_t* target = &best[level * 9];
+    bool blank_tried = false;
+
+    for(int row = 0; row < 9; row++){
+        bool allowed = level % 3 == 0 ? (used & (7 << (row / 3 * 3))) == 0 : row / 3 == band && !(used & (1 << row));
+        if(!allowed || masks[row] != pattern[level]){
+            continue;
+        }
+
+        // A new band must have the rows the pattern asks for, or the branch would end before its last row.
+        if(level % 3 == 0){
+            uint16_t rows[3] = {masks[row / 3 * 3], masks[row / 3 * 3 + 1], masks[row / 3 * 3 + 2]};
+            sort(rows, rows + 3);
+            if(!equal(rows, rows + 3, pattern + level)){
+                continue;
+            }
+        }
+
+        // Two blank rows of the same band give the same board, only the first is tried.
+        if(level % 3 != 0 && masks[row] == 0){
+            if(blank_tried){
+                continue;
+            }
+            blank_tried = true;
+        }
+
+        // Relabel the row and compare it with the same row of the best board as it is built.
+        uint8_t line[9];
+        uint8_t next_labels[10];
+        int next = next_label;
+        int order = 0;
+        memcpy(next_labels, labels, sizeof(next_labels));
+
+        for(int j = 0; j < 9 && order <= 0; j++){
+            int digit = source[row * 9 + columns[j]];
+            if(digit != 0 && next_labels[digit] == 0){
+                next_labels[digit] = ++next;
+            }
+            line[j] = next_labels[digit];
+            if(order == 0){
+                order = line[j] < target[j] ? -1 : line[j] > target[j] ? 1 : 0;
+            }
+        }
+        if(order > 0){
+            continue;
+        }
+
+        if(order < 0){
+            // A smaller prefix: everything after it is beaten by any completion.
+            memcpy(target, line, 9);
+            memset(target + 9, 0xFF, 81 - (level + 1) * 9);
+        }
+        path[level] = row;
+
+        if(level == 8){
+            if(order < 0){
+                best_transform.transpose = transpose;
+                memcpy(best_transform.rows, path, 9);
+                memcpy(best_transform.columns, columns, 9);
+                memcpy(best_transform.labels, next_labels, 10);
+            }
+        }
+        else{
+            search(level + 1, row / 3, used | (1 << row), next_labels, next);
+        }
+    }
+}
+
+/// @brief Finds the canonical form of a puzzle and the transform that leads there.
+void Canonicalizer::run(const Grid& grid, uint8_t canon[81], Transform& transform){
+
+    for(int cell = 0; cell < 81; cell++){
+        sources[0][cell] = grid.get(cell);
+        sources[1][cell] = grid.get(column_of(cell) * 9 + row_of(cell));
+    }
+
+    // Givens of every row as a 3-bit mask per stack, with the column order within the stack applied. Bit 2 is the
+    // first column, so comparing masks compares the patterns of the rows.
+    for(int side = 0; side < 2; side++){
+        for(int row = 0; row < 9; row++){
+            for(int stack = 0; stack < 3; stack++){
+                for(int order = 0; order < 6; order++){
+                    uint8_t mask = 0;
+                    for(int k = 0; k < 3; k++){
+                        mask = (mask << 1) | (sources[side][row * 9 + stack * 3 + ORDERS[order][k]] != 0);
+                    }
+                    stack_masks[side][row][stack][order] = mask;
+                }
+            }
+        }
+    }
+
+    find_pattern();
+
+    memset(best, 0xFF, sizeof(best));
+    for(int i = 0; i < candidate_count; i++){
+        const Choice& candidate = candidates[i];
+        transpose = candidate.side;
+        source = sources[candidate.side];
+        for(int j = 0; j < 9; j++){
+            columns[j] = candidate.stacks[j / 3] * 3 + ORDERS[candidate.orders[j / 3]][j % 3];
+        }
+
+        for(int row = 0; row < 9; row++){
+            masks[row] = 0;
+            for(int j = 0; j < 9; j++){
+                masks[row] = (masks[row] << 1) | (source[row * 9 + columns[j]] != 0);
+            }
+        }
+
+        uint8_t labels[10] = {0};
+        search(0, 0, 0, labels, 0);
+    }
+
+    // Digits that are not in the puzzle take the labels left over, so the transform is a full relabeling.
+    int next = 0;
+    for(int digit = 1; digit <= 9; digit++){
+        next = max<int>(next, best_transform.labels[digit]);
+    }
+    for(int digit = 1; digit <= 9; digit++){
+        if(best_transform.labels[digit] == 0){
+            best_transform.labels[digit] = ++next;
+        }
+    }
+
+    memcpy(canon, best, 81);
+    transform = best_transform;
+}
+
+/// @brief Computes the canonical form of a puzzle.
+/// @param grid The puzzle.
+/// @param canon Receives the 81 values of the canonical board, 0 for blanks.
+/// @param transform Receives a transform that turns the puzzle into canon.
+void canonicalize(const Grid& grid, uint8_t canon[81], Transform& transform){
+    Canonicalizer canonicalizer;
+    canonicalizer.run(grid, canon, transform);
+}
+
+/// @brief Applies a transform to a board, for example to a solution of the source puzzle.
+/// @param transform The transform.
+/// @param source The 81 values of the board, 0 for blanks.
+/// @param target Receives the 81 transformed values.
+void apply_transform(const Transform& transform, const uint8_t source[81], uint8_t target[81]){
+    for(int i = 0; i < 9; i++){
+        for(int j = 0; j < 9; j++){
+            int row = transform.rows[i];
+            int column = transform.columns[j];
+            int cell = transform.transpose ? column * 9 + row : row * 9 + column;
+            target[i * 9 + j] = transform.labels[source[cell]];
+        }
+    }
+}
+
+/// @brief Undoes a transform, for example to turn the solution of a canonical puzzle into the solution of the source.
+/// @param transform The transform.
+/// @param canon The 81 values of the transformed board, 0 for blanks.
+/// @param source Receives the 81 values of the board before the transform.
+void invert_transform(const Transform& transform, const uint8_t canon[81], uint8_t source[81]){
+
+    uint8_t digits[10];
+    for(int digit = 0; digit <= 9; digit++){
+        digits[transform.labels[digit]] = digit;
+    }
+
+    for(int i = 0; i < 9; i++){
+        for(int j = 0; j < 9; j++){
+            int row = transform.rows[i];
+            int column = transform.columns[j];
+            int cell = transform.transpose ? column * 9 + row : row * 9 + column;
+            source[cell] = digits[canon[i * 9 + j]];
+        }
+    }
+}
+
+#endif
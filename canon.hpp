@@ -0,0 +1,28 @@
+#ifndef CANON_H
+#define CANON_H
+#include "grid.hpp"
+#include <cstdint>
+
+using namespace std;
+
+/// @brief One symmetry of the 9x9 board: an optional transposition, a permutation of the rows and one of the columns
+///         (bands and stacks, and the rows and columns within them) and a relabeling of the digits.
+///         Cell (i, j) of the transformed board holds labels[d], where d is the digit of the source board at
+///         (rows[i], columns[j]), read from the transposed source when transpose is set.
+struct Transform{
+    bool transpose = false;
+    uint8_t rows[9];
+    uint8_t columns[9];
+    uint8_t labels[10]; // labels[0] is 0, blanks stay blank
+};
+
+/// @brief Canonical form of a puzzle under the Sudoku symmetry group: the smallest of all the boards reachable with
+///         the 3,359,232 geometric transforms and the relabelings of the digits, comparing the pattern of givens first
+///         and the digits second. Two puzzles have the same canonical form exactly when one can be turned into the
+///         other.
+void canonicalize(const Grid& grid, uint8_t canon[81], Transform& transform);
+
+void apply_transform(const Transform& transform, const uint8_t source[81], uint8_t target[81]); // Source to canonical
+void invert_transform(const Transform& transform, const uint8_t canon[81], uint8_t source[81]); // Canonical to source
+
+#endif
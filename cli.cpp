@@ -0,0 +1,390 @@
+#ifndef CLI_CPP
+#define CLI_CPP
+#include "cli.hpp"
+#include "batch.hpp"
+#include "enumerate.hpp"
+#include "generator.hpp"
+#include "grade.hpp"
+#include "pack.hpp"
+#include "server.hpp"
+#include "validate.hpp"
+#include "variant.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+/// @brief Prints the command line usage to the given stream.
+static void print_usage(ostream& out){
+    out << "Usage:" << endl;
+    out << "  sudoku                          interactive mode" << endl;
+    out << "  sudoku --batch FILE [options]   solve one puzzle per line (81 characters for 9x9)" << endl;
+    out << "  sudoku --generate N [options]   generate N puzzles with a unique solution" << endl;
+    out << "  sudoku --enumerate FILE [options] write every solution of every puzzle, one per line" << endl;
+    out << "  sudoku --variant FILE [options] solve variant puzzles: 81 characters, then the rules of the puzzle" << endl;
+    out << "  sudoku --grade FILE [options]    rate every puzzle by the hardest technique it needs" << endl;
+    out << "  sudoku --validate FILE [options] check one board per line, optionally against its puzzle" << endl;
+    out << "  sudoku --serve SOCKET [options] answer solve/validate/count/generate requests on a Unix socket," << endl;
+    out << "                                  or on standard input and output with - (see server.hpp)" << endl;
+    out << "  sudoku --pack FILE --output F   convert puzzles to the packed binary format (41 bytes each)" << endl;
+    out << "  sudoku --unpack FILE [options]  convert a packed file back to text" << endl;
+    out << endl;
+    out << "Options:" << endl;
+    out << "  --output FILE    write the results to FILE instead of standard output" << endl;
+    out << "  --threads N      number of worker threads, 0 for one per core (default)" << endl;
+    out << "  --engine NAME    solver engine: backtrack (default), dlx or sliced" << endl;
+    out << "  --heuristic NAME branching of the backtrack engine: first (default), mrv, degree or lcv" << endl;
+    out << "  --seed S         seed for --generate, the same seed gives the same puzzles (default 0)" << endl;
+    out << "  --rating A[-B]   for --generate, only puzzles rated A (to B): singles, locked, subsets, fish, chains" << endl;
+    out << "                   or beyond (9x9 only)" << endl;
+    out << "  --givens N       for --generate, puzzles with exactly N givens, 21 to 81 (9x9 only)" << endl;
+    out << "  --size N         board size for --batch, --generate and --enumerate: 4, 9 (default), 16 or 25" << endl;
+    out << "  --cache N        for --batch, keep up to N solutions keyed by canonical form, so repeated and" << endl;
+    out << "                   isomorphic puzzles are not searched again (9x9 only)" << endl;
+    out << "  --limit N        for --enumerate, stop after N solutions per puzzle (default 0, all of them)" << endl;
+    out << "  --rules LIST     for --variant, rules of every puzzle: x, anti-knight, jigsaw=..., killer=..." << endl;
+    out << "                   (see variant.hpp)" << endl;
+    out << "  --max-nodes N    for --batch, --generate, --variant and --serve, give up on a puzzle or request after" << endl;
+    out << "                   N search nodes" << endl;
+    out << "  --timeout S      for --batch, --generate, --variant and --serve, give up on a puzzle or request after" << endl;
+    out << "                   S seconds" << endl;
+    out << "  --portfolio LIST for --batch, strategies that take turns on every puzzle with doubling node slices, the" << endl;
+    out << "                   first to finish wins: engine[:heuristic],... e.g. backtrack:first,backtrack:mrv,dlx" << endl;
+    out << "  --portfolio-log FILE  write one JSON line per puzzle with the winning strategy and puzzle features" << endl;
+    out << "  --split          for --batch, solve one puzzle at a time with every thread searching it, for a few" << endl;
+    out << "                   very hard puzzles rather than many easy ones; for --generate, make one puzzle at a" << endl;
+    out << "                   time with every thread on its uniqueness checks (the default for a few 16x16 or 25x25)" << endl;
+    out << "  --clues FILE     for --validate, the puzzle of every board line for line; givens must be kept" << endl;
+    out << "  --solutions FILE for --pack, solution lines matching the puzzles, stored next to them" << endl;
+    out << "  --index K        for --unpack, only write puzzle K (counting from 0)" << endl;
+    out << "  --layout NAME    text side of --pack/--unpack: line (default) or grid, the puzzle file layout" << endl;
+    out << "  --stats FILE     write search counters and phase times merged over all puzzles" << endl;
+    out << "  --stats-format F json (default) or prometheus, for --stats" << endl;
+    out << "  --puzzle-stats FILE  write one JSON line of counters per puzzle (--batch only)" << endl;
+    out << "                   the stats options need a build with -DSUDOKU_STATS" << endl;
+}
+
+/// @brief Returns the value following an option, exits with an error if it is missing.
+static const char* option_value(int argc, char* argv[], int& i){
+    if(i + 1 >= argc){
+        cerr << "ERROR: " << argv[i] << " expects a value." << endl;
+        exit(EXIT_FAILURE);
+    }
+    return argv[++i];
+}
+
+/// @brief Parses a non-negative integer option value, exits with an error if it is not one.
+static unsigned long number_value(const char* option, const char* value){
+    char* end;
+    unsigned long number = strtoul(value, &end, 10);
+
+    if(*value == '\0' || *end != '\0' || *value == '-'){
+        cerr << "ERROR: " << option << " expects a non-negative number, got " << value << "." << endl;
+        exit(EXIT_FAILURE);
+    }
+    return number;
+}
+
+/// @brief Parses the command line and runs the selected mode. Results go to standard output or the output file,
+///         the summary goes to standard error so it never mixes with the results.
+/// @return The process exit status.
+int run_cli(int argc, char* argv[]){
+
+    string mode;
+    BatchOptions batch;
+    GenerateOptions generate;
+    PackOptions pack;
+    ValidateOptions validate;
+    ServerOptions serve;
+    EnumerateOptions enumerate;
+    GradeOptions grade;
+    VariantOptions variant;
+
+    for(int i = 1; i < argc; i++){
+        const char* arg = argv[i];
+
+        if(strcmp(arg, "--batch") == 0){
+            mode = "batch";
+            batch.input = option_value(argc, argv, i);
+        }
+        else if(strcmp(arg, "--generate") == 0){
+            mode = "generate";
+            generate.count = number_value(arg, option_value(argc, argv, i));
+        }
+        else if(strcmp(arg, "--rating") == 0){
+            string band = option_value(argc, argv, i);
+            size_t dash = band.find('-');
+            if(!parse_difficulty(band.substr(0, dash), generate.min_rating) ||
+               !parse_difficulty(dash == string::npos ? band : band.substr(dash + 1), generate.max_rating)){
+                cerr << "ERROR: Unknown rating " << band << ", expected singles, locked, subsets, fish, chains or "
+                     << "beyond, or two of them joined by -." << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strcmp(arg, "--givens") == 0){
+            generate.givens = min<unsigned long>(number_value(arg, option_value(argc, argv, i)), 82);
+        }
+        else if(strcmp(arg, "--grade") == 0){
+            mode = "grade";
+            grade.input = option_value(argc, argv, i);
+        }
+        else if(strcmp(arg, "--seed") == 0){
+            generate.seed = number_value(arg, option_value(argc, argv, i));
+        }
+        else if(strcmp(arg, "--size") == 0){
+            unsigned long size = number_value(arg, option_value(argc, argv, i));
+            if(size != 4 && size != 9 && size != 16 && size != 25){
+                cerr << "ERROR: Unsupported board size " << size << ", expected 4, 9, 16 or 25." << endl;
+                return EXIT_FAILURE;
+            }
+            batch.box = size == 4 ? 2 : size == 9 ? 3 : size == 16 ? 4 : 5;
+        }
+        else if(strcmp(arg, "--cache") == 0){
+            batch.cache = number_value(arg, option_value(argc, argv, i));
+        }
+        else if(strcmp(arg, "--serve") == 0){
+            mode = "serve";
+            serve.socket = option_value(argc, argv, i);
+        }
+        else if(strcmp(arg, "--max-nodes") == 0){
+            batch.budget.nodes = number_value(arg, option_value(argc, argv, i));
+        }
+        else if(strcmp(arg, "--timeout") == 0){
+            const char* value = option_value(argc, argv, i);
+            char* end;
+            batch.budget.seconds = strtod(value, &end);
+            if(*value == '\0' || *end != '\0' || !(batch.budget.seconds > 0)){
+                cerr << "ERROR: " << arg << " expects a positive number of seconds, got " << value << "." << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strcmp(arg, "--portfolio") == 0){
+            const char* list = option_value(argc, argv, i);
+            if(!parse_portfolio(list, batch.portfolio)){
+                cerr << "ERROR: Unknown portfolio " << list << ", expected engine[:heuristic] entries separated by "
+                     << "commas." << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strcmp(arg, "--portfolio-log") == 0){
+            batch.portfolio_log = option_value(argc, argv, i);
+        }
+        else if(strcmp(arg, "--split") == 0){
+            batch.split = true;
+        }
+        else if(strcmp(arg, "--pack") == 0 || strcmp(arg, "--unpack") == 0){
+            mode = arg + 2;
+            pack.input = option_value(argc, argv, i);
+        }
+        else if(strcmp(arg, "--enumerate") == 0){
+            mode = "enumerate";
+            enumerate.input = option_value(argc, argv, i);
+        }
+        else if(strcmp(arg, "--limit") == 0){
+            enumerate.limit = number_value(arg, option_value(argc, argv, i));
+        }
+        else if(strcmp(arg, "--variant") == 0){
+            mode = "variant";
+            variant.input = option_value(argc, argv, i);
+        }
+        else if(strcmp(arg, "--rules") == 0){
+            const char* value = option_value(argc, argv, i);
+            if(!parse_rules(value, strlen(value), variant.rules)){
+                cerr << "ERROR: Unknown or malformed rules " << value << ", see variant.hpp for the format." << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strcmp(arg, "--validate") == 0){
+            mode = "validate";
+            validate.input = option_value(argc, argv, i);
+        }
+        else if(strcmp(arg, "--clues") == 0){
+            validate.clues = option_value(argc, argv, i);
+        }
+        else if(strcmp(arg, "--solutions") == 0){
+            pack.solutions = option_value(argc, argv, i);
+        }
+        else if(strcmp(arg, "--index") == 0){
+            pack.has_index = true;
+            pack.index = number_value(arg, option_value(argc, argv, i));
+        }
+        else if(strcmp(arg, "--layout") == 0){
+            string layout = option_value(argc, argv, i);
+            if(layout != "line" && layout != "grid"){
+                cerr << "ERROR: Unknown layout " << layout << ", expected line or grid." << endl;
+                return EXIT_FAILURE;
+            }
+            pack.grid_layout = layout == "grid";
+        }
+        else if(strcmp(arg, "--output") == 0 || strcmp(arg, "-o") == 0){
+            batch.output = option_value(argc, argv, i);
+        }
+        else if(strcmp(arg, "--threads") == 0 || strcmp(arg, "-t") == 0){
+            batch.threads = number_value(arg, option_value(argc, argv, i));
+        }
+        else if(strcmp(arg, "--engine") == 0 || strcmp(arg, "-e") == 0){
+            const char* name = option_value(argc, argv, i);
+            if(!parse_engine(name, batch.engine)){
+                cerr << "ERROR: Unknown engine " << name << ", expected backtrack, dlx or sliced." << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strcmp(arg, "--heuristic") == 0){
+            const char* name = option_value(argc, argv, i);
+            if(!parse_heuristic(name, batch.heuristic)){
+                cerr << "ERROR: Unknown heuristic " << name << ", expected first, mrv, degree or lcv." << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        else if(strcmp(arg, "--stats") == 0){
+            batch.stats = option_value(argc, argv, i);
+        }
+        else if(strcmp(arg, "--puzzle-stats") == 0){
+            batch.puzzle_stats = option_value(argc, argv, i);
+        }
+        else if(strcmp(arg, "--stats-format") == 0){
+            string format = option_value(argc, argv, i);
+            if(format != "json" && format != "prometheus"){
+                cerr << "ERROR: Unknown stats format " << format << ", expected json or prometheus." << endl;
+                return EXIT_FAILURE;
+            }
+            batch.prometheus = format == "prometheus";
+        }
+        else if(strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0){
+            print_usage(cout);
+            return EXIT_SUCCESS;
+        }
+        else{
+            cerr << "ERROR: Unknown option " << arg << "." << endl;
+            print_usage(cerr);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(!STATS_ENABLED && (!batch.stats.empty() || !batch.puzzle_stats.empty())){
+        cerr << "ERROR: Stats are not compiled in, rebuild with -DSUDOKU_STATS." << endl;
+        return EXIT_FAILURE;
+    }
+
+    if(!batch.portfolio_log.empty() && batch.portfolio.empty()){
+        cerr << "ERROR: --portfolio-log needs a --portfolio." << endl;
+        return EXIT_FAILURE;
+    }
+
+    if(mode == "batch"){
+        BatchResult result = solve_batch(batch);
+
+        cerr << "Solved " << result.solved << " of " << result.puzzles << " puzzles in " << result.seconds << " s ("
+             << (result.seconds > 0 ? result.puzzles / result.seconds : 0) << " puzzles/sec)." << endl;
+        if(result.exhausted > 0){
+            cerr << "Gave up on " << result.exhausted << " puzzles that ran out of budget." << endl;
+        }
+        for(size_t i = 0; i < batch.portfolio.size(); i++){
+            cerr << (i == 0 ? "Portfolio wins: " : ", ") << strategy_name(batch.portfolio[i]) << " "
+                 << result.wins[i] << (i + 1 == batch.portfolio.size() ? ".\n" : "");
+        }
+        if(batch.cache > 0){
+            cerr << "Cache: " << result.cache_hits << " hits, " << result.cache_misses << " misses." << endl;
+        }
+        return result.solved == result.puzzles ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if(mode == "generate"){
+        generate.box = batch.box;
+        generate.threads = batch.threads;
+        generate.output = batch.output;
+        generate.stats = batch.stats;
+        generate.prometheus = batch.prometheus;
+        generate.split = batch.split;
+        generate.budget = batch.budget;
+        GenerateResult result = generate_batch(generate);
+
+        cerr << "Generated " << generate.count - result.failed << " of " << generate.count << " puzzles in "
+             << result.seconds << " s (" << (result.seconds > 0 ? generate.count / result.seconds : 0)
+             << " puzzles/sec)." << endl;
+        if(result.failed > 0){
+            cerr << "Gave up on " << result.failed << " puzzles that ran out of budget or attempts." << endl;
+        }
+        return result.failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if(mode == "enumerate"){
+        enumerate.output = batch.output;
+        enumerate.threads = batch.threads;
+        enumerate.box = batch.box;
+        EnumerateResult result = enumerate_batch(enumerate);
+
+        cerr << "Enumerated " << result.solutions << " solutions of " << result.puzzles << " puzzles in "
+             << result.seconds << " s (" << (result.seconds > 0 ? result.solutions / result.seconds : 0)
+             << " solutions/sec)." << endl;
+        return EXIT_SUCCESS;
+    }
+
+    if(mode == "variant"){
+        variant.output = batch.output;
+        variant.threads = batch.threads;
+        variant.budget = batch.budget;
+        VariantResult result = solve_variant_batch(variant);
+
+        cerr << "Solved " << result.solved << " of " << result.puzzles << " variant puzzles in " << result.seconds
+             << " s (" << (result.seconds > 0 ? result.puzzles / result.seconds : 0) << " puzzles/sec)." << endl;
+        if(result.exhausted > 0){
+            cerr << "Gave up on " << result.exhausted << " puzzles that ran out of budget." << endl;
+        }
+        return result.solved == result.puzzles ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if(mode == "grade"){
+        grade.output = batch.output;
+        grade.threads = batch.threads;
+        GradeResult result = grade_batch(grade);
+
+        cerr << "Graded " << result.puzzles << " puzzles in " << result.seconds << " s ("
+             << (result.seconds > 0 ? result.puzzles / result.seconds : 0) << " puzzles/sec):";
+        for(int level = 0; level < 6; level++){
+            cerr << " " << result.counts[level] << " " << difficulty_name((Difficulty)level) << ",";
+        }
+        cerr << " " << result.invalid << " invalid." << endl;
+        return result.invalid == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if(mode == "validate"){
+        validate.output = batch.output;
+        validate.threads = batch.threads;
+        ValidateResult result = validate_batch(validate);
+
+        cerr << "Checked " << result.boards << " boards in " << result.seconds << " s ("
+             << (result.seconds > 0 ? result.boards / result.seconds : 0) << " boards/sec, " << validation_kernel()
+             << "): " << result.solved << " solved, " << result.valid << " valid, " << result.invalid << " invalid, "
+             << result.malformed << " malformed." << endl;
+        return result.invalid + result.malformed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    if(mode == "serve"){
+        serve.threads = batch.threads;
+        serve.engine = batch.engine;
+        serve.heuristic = batch.heuristic;
+        serve.budget = batch.budget;
+        ServerResult result = run_server(serve);
+
+        cerr << "Served " << result.requests << " requests from " << result.connections << " clients in "
+             << result.batches << " batches." << endl;
+        return EXIT_SUCCESS;
+    }
+
+    if(mode == "pack" || mode == "unpack"){
+        pack.output = batch.output;
+        uint64_t count = mode == "pack" ? pack_file(pack) : unpack_file(pack);
+
+        cerr << (mode == "pack" ? "Packed " : "Unpacked ") << count << " puzzles." << endl;
+        return EXIT_SUCCESS;
+    }
+
+    print_usage(cerr);
+    return EXIT_FAILURE;
+}
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef CLI_H
+#define CLI_H
+
+int run_cli(int argc, char* argv[]); // Runs the non-interactive mode selected by the command line arguments
+
+#endif
@@ -0,0 +1,106 @@
+#ifndef COUNT_CPP
+#define COUNT_CPP
+#include "count.hpp"
+#include "budget.hpp"
+#include "propagate.hpp"
+
+/// @brief Counts the solutions below a propagated state. Branches on the cell with the fewest candidates; each guess
+///         propagates its own consequences and is rolled back before the next one, so the search works on a single grid
+///         and propagator.
+/// @param grid The grid the propagator was run on, it is back in the same state on return.
+/// @param state The propagated candidate state, also restored on return.
+/// @param limit The search stops once this many solutions are found.
+/// @return The number of solutions found, at most limit. Only the ones found so far once the budget is spent.
+static int count_helper(Grid& grid, Propagator& state, int limit){
+
+    STAT_ADD(nodes, 1);
+    STAT_DEPTH();
+
+    if(!budget_node()){
+        return 0;
+    }
+
+    int cell = state.best_cell();
+    if(cell == -1){
+        return 1; // Every cell is filled.
+    }
+
+    int found = 0;
+    Propagator::Checkpoint checkpoint;
+    state.checkpoint(checkpoint);
+    for(uint16_t mask = state.candidates(cell); mask != 0 && found < limit; mask &= mask - 1){
+        STAT_ADD(candidates_tried, 1);
+
+        if(state.assume(grid, cell, __builtin_ctz(mask) + 1)){
+            found += count_helper(grid, state, limit - found);
+        }
+        state.rollback(grid, checkpoint);
+        STAT_ADD(backtracks, 1);
+    }
+    return found;
+}
+
+/// @brief Counts the solutions of a grid with early exit. With a limit of 2 this is the uniqueness test: 0 means no
+///         solution, 1 a unique solution and 2 more than one.
+/// @param grid The puzzle, it is not changed.
+/// @param limit The search stops as soon as this many solutions are found.
+/// @return The number of solutions, at most limit. 0 if the givens repeat a digit.
+int count_solutions(const Grid& grid, int limit){
+
+    Grid work = grid;
+    Propagator state;
+
+    if(limit <= 0 || !state.run(work)){
+        return 0;
+    }
+    return count_helper(work, state, limit);
+}
+
+/// @brief Counts the solutions below a grid of any size by backtracking where BasicGrid::best_branch says.
+/// @param grid The partial grid, every placement is undone before returning.
+/// @param limit The search stops once this many solutions are found.
+/// @return The number of solutions found, at most limit.
+template<int Box>
+static int count_helper(BasicGrid<Box>& grid, int limit){
+
+    STAT_ADD(nodes, 1);
+    STAT_DEPTH();
+
+    if(!budget_node()){
+        return 0;
+    }
+
+    int cell;
+    typename BasicGrid<Box>::Mask choices;
+    if(!grid.best_branch(cell, choices)){
+        return 0;
+    }
+    if(cell == -1){
+        return 1; // Every cell is filled.
+    }
+
+    int found = 0;
+    for(typename BasicGrid<Box>::Mask mask = choices; mask != 0 && found < limit; mask &= mask - 1){
+        grid.place(cell, __builtin_ctz(mask) + 1);
+        STAT_ADD(candidates_tried, 1);
+
+        found += count_helper(grid, limit - found);
+        grid.unplace(cell);
+        STAT_ADD(backtracks, 1);
+    }
+    return found;
+}
+
+/// @brief Counts the solutions of a 4x4, 16x16 or 25x25 grid with early exit. The 9x9 grid takes the propagating
+///         overload above.
+/// @param grid The puzzle, it is not changed.
+/// @param limit The search stops as soon as this many solutions are found.
+/// @return The number of solutions, at most limit.
+template<int Box>
+int count_solutions(const BasicGrid<Box>& grid, int limit){
+
+    BasicGrid<Box> work = grid;
+    return limit > 0 ? count_helper(work, limit) : 0;
+}
+
+#endif
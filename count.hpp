@@ -0,0 +1,12 @@
+#ifndef COUNT_H
+#define COUNT_H
+#include "grid.hpp"
+
+using namespace std;
+
+int count_solutions(const Grid& grid, int limit); // Number of solutions, stopping as soon as limit are found
+
+template<int Box>
+int count_solutions(const BasicGrid<Box>& grid, int limit); // The same for the other board sizes
+
+#endif
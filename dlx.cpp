@@ -0,0 +1,181 @@
+#ifndef DLX_CPP
+#define DLX_CPP
+#include "dlx.hpp"
+#include "budget.hpp"
+
+/// @brief Constructor for the DancingLinks class. Links the 324 column headers in a ring behind the root and adds the
+///         four nodes of each of the 729 rows to their columns.
+DancingLinks::DancingLinks(){
+
+    for(int col = 0; col <= ROOT; col++){
+        left[col] = col == 0 ? ROOT : col - 1;
+        right[col] = col == ROOT ? 0 : col + 1;
+        up[col] = col;
+        down[col] = col;
+        column[col] = col;
+        row[col] = -1;
+    }
+    for(int col = 0; col < COLUMNS; col++){
+        size[col] = 0;
+    }
+
+    int node = ROOT + 1;
+    for(int r = 0; r < ROWS; r++){
+        int cell = r / 9;
+        int digit = r % 9;
+        int columns[4] = {
+            cell,
+            81 + row_of(cell) * 9 + digit,
+            162 + column_of(cell) * 9 + digit,
+            243 + box_of(cell) * 9 + digit
+        };
+
+        first_node[r] = node;
+        for(int i = 0; i < 4; i++, node++){
+            int col = columns[i];
+
+            // Append the node at the bottom of its column.
+            column[node] = col;
+            row[node] = r;
+            up[node] = up[col];
+            down[node] = col;
+            down[up[col]] = node;
+            up[col] = node;
+            size[col]++;
+
+            // Link the four nodes of the row into a ring.
+            left[node] = i == 0 ? node + 3 : node - 1;
+            right[node] = i == 3 ? node - 3 : node + 1;
+        }
+    }
+}
+
+/// @brief Removes a column from the header list and every row that intersects it from the other columns.
+/// @param col The column header index.
+void DancingLinks::cover(int col){
+    right[left[col]] = right[col];
+    left[right[col]] = left[col];
+
+    for(int i = down[col]; i != col; i = down[i]){
+        for(int j = right[i]; j != i; j = right[j]){
+            down[up[j]] = down[j];
+            up[down[j]] = up[j];
+            size[column[j]]--;
+        }
+    }
+}
+
+/// @brief Exact reverse of cover, the links of the removed nodes still point at their old neighbours.
+/// @param col The column header index.
+void DancingLinks::uncover(int col){
+    for(int i = up[col]; i != col; i = up[i]){
+        for(int j = left[i]; j != i; j = left[j]){
+            size[column[j]]++;
+            down[up[j]] = j;
+            up[down[j]] = j;
+        }
+    }
+
+    right[left[col]] = col;
+    left[right[col]] = col;
+}
+
+/// @brief Puts a row in the partial solution by covering the columns of all its nodes.
+/// @param row_node Any node of the row.
+void DancingLinks::select(int row_node){
+    cover(column[row_node]);
+    for(int j = right[row_node]; j != row_node; j = right[j]){
+        cover(column[j]);
+    }
+}
+
+/// @brief Takes a row back out of the partial solution, in the reverse order of select.
+/// @param row_node The same node that was passed to select.
+void DancingLinks::deselect(int row_node){
+    for(int j = left[row_node]; j != row_node; j = left[j]){
+        uncover(column[j]);
+    }
+    uncover(column[row_node]);
+}
+
+/// @brief Algorithm X. Branches on the column with the fewest rows left and tries each of its rows.
+/// @param depth The number of rows chosen by the search so far.
+/// @param out Receives the solution.
+/// @return True if a solution was found. The links are restored either way.
+bool DancingLinks::search(int depth, Grid& out){
+
+    STAT_ADD(nodes, 1);
+    STAT_DEPTH();
+
+    if(!budget_node()){
+        return false; // The budget of the thread is spent.
+    }
+
+    if(right[ROOT] == ROOT){
+        // Every constraint is satisfied, the chosen rows are the missing digits.
+        for(int i = 0; i < depth; i++){
+            int r = row[solution[i]];
+            out.place(r / 9, r % 9 + 1);
+        }
+        return true;
+    }
+
+    // Choose the column with the fewest remaining rows.
+    int best = right[ROOT];
+    for(int col = right[best]; col != ROOT; col = right[col]){
+        if(size[col] < size[best]){
+            best = col;
+            if(size[best] <= 1){
+                break;
+            }
+        }
+    }
+    if(size[best] == 0){
+        return false; // A constraint can no longer be satisfied.
+    }
+
+    bool found = false;
+    cover(best);
+    for(int i = down[best]; i != best && !found; i = down[i]){
+        solution[depth] = i;
+        STAT_ADD(candidates_tried, 1);
+        for(int j = right[i]; j != i; j = right[j]){
+            cover(column[j]);
+        }
+
+        found = search(depth + 1, out);
+        STAT_ADD(backtracks, !found);
+
+        for(int j = left[i]; j != i; j = left[j]){
+            uncover(column[j]);
+        }
+    }
+    uncover(best);
+    return found;
+}
+
+/// @brief Solves a grid. The givens are selected first, the search fills in the rest and afterwards every link is
+///         restored, so the arena is ready for the next puzzle.
+/// @param grid The puzzle, must have consistent givens. Receives the solution.
+/// @return True if a solution was found, otherwise false and the grid is left as it was.
+bool DancingLinks::solve(Grid& grid){
+
+    int givens[81];
+    int given_count = 0;
+
+    for(int cell = 0; cell < 81; cell++){
+        if(grid.get(cell) != 0){
+            givens[given_count] = first_node[cell * 9 + grid.get(cell) - 1];
+            select(givens[given_count++]);
+        }
+    }
+
+    bool solved = search(0, grid);
+
+    while(given_count > 0){
+        deselect(givens[--given_count]);
+    }
+    return solved;
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef DLX_H
+#define DLX_H
+#include "grid.hpp"
+
+using namespace std;
+
+/// @brief Dancing Links (Knuth's Algorithm X) exact-cover solver.
+///         Sudoku is modelled as 324 constraint columns (cell, row-digit, column-digit, box-digit) and 729 rows, one per
+///         cell and digit. The node arena is built once in the constructor; every solve covers the givens, searches and
+///         uncovers everything again, so one instance can be reused across any number of puzzles.
+class DancingLinks{
+    public:
+
+        DancingLinks(); // Constructor, builds the full 729 x 324 matrix
+
+        bool solve(Grid& grid); // Fills the grid with the first solution found, false if there is none
+
+    private:
+        static const int COLUMNS = 324;
+        static const int ROWS = 729;
+        static const int ROOT = COLUMNS; // Header of the column list
+        static const int NODES = COLUMNS + 1 + ROWS * 4;
+
+        void cover(int column);
+        void uncover(int column);
+        void select(int row_node); // Covers every column of the row the node is in
+        void deselect(int row_node);
+        bool search(int depth, Grid& out);
+
+        // Arena of doubly linked nodes, indices 0..323 are column headers and ROOT is the root header.
+        int left[NODES];
+        int right[NODES];
+        int up[NODES];
+        int down[NODES];
+        int column[NODES];
+        int row[NODES]; // Matrix row of the node, cell * 9 + digit - 1
+        int size[COLUMNS];
+        int first_node[ROWS]; // First node of every matrix row
+        int solution[81]; // Nodes chosen by the search, one per depth
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef ENGINE_CPP
+#define ENGINE_CPP
+#include "engine.hpp"
+#include "dlx.hpp"
+#include "sliced.hpp"
+
+/// @brief Maps an engine name from the command line to the engine.
+/// @param name "backtrack", "dlx" or "sliced".
+/// @param engine Receives the engine.
+/// @return True if the name is known.
+bool parse_engine(const string& name, Engine& engine){
+    if(name == "backtrack"){
+        engine = Engine::backtrack;
+    }
+    else if(name == "dlx"){
+        engine = Engine::dlx;
+    }
+    else if(name == "sliced"){
+        engine = Engine::sliced;
+    }
+    else{
+        return false;
+    }
+    return true;
+}
+
+/// @brief Returns the name parse_engine accepts for an engine.
+const char* engine_name(Engine engine){
+    switch(engine){
+        case Engine::backtrack: return "backtrack";
+        case Engine::dlx: return "dlx";
+        case Engine::sliced: return "sliced";
+    }
+    return "unknown";
+}
+
+/// @brief Solves a grid with the chosen engine. Each thread keeps its own Dancing Links arena, so it is only built
+///         once per thread and never shared. The sliced engine is meant for many puzzles at once (see solve_sliced), here
+///         it propagates a group of one.
+/// @param grid The puzzle, must have consistent givens. Receives the solution.
+/// @param engine The engine to run.
+/// @param heuristic The branching heuristic of the backtrack engine, Dancing Links has its own column order and the
+///         sliced engine searches with Grid::solve.
+/// @return True if a solution was found, otherwise false and the grid is left as it was.
+bool solve_grid(Grid& grid, Engine engine, Heuristic heuristic){
+
+    if(engine == Engine::dlx){
+        static thread_local DancingLinks links;
+        return links.solve(grid);
+    }
+    if(engine == Engine::sliced){
+        bool solved;
+        solve_sliced(&grid, 1, &solved);
+        return solved;
+    }
+    return solve_heuristic(grid, heuristic);
+}
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+#include "grid.hpp"
+#include "heuristic.hpp"
+#include <string>
+
+using namespace std;
+
+/// @brief The solver engines that can be picked at runtime.
+enum class Engine{
+    backtrack, // Grid bitmask backtracking, branching where the Heuristic says
+    dlx, // Dancing Links exact cover
+    sliced // Lockstep propagation of many boards in vector lanes, then backtracking on the ones left open
+};
+
+bool parse_engine(const string& name, Engine& engine); // Maps a command line name to an engine, false if unknown
+const char* engine_name(Engine engine); // Name of the engine as accepted by parse_engine
+
+bool solve_grid(Grid& grid, Engine engine, Heuristic heuristic = Heuristic::first); // Solves the grid in place
+
+#endif
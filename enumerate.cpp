@@ -0,0 +1,264 @@
+#ifndef ENUMERATE_CPP
+#define ENUMERATE_CPP
+#include "enumerate.hpp"
+#include "budget.hpp"
+#include "io.hpp"
+#include "thread_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <mutex>
+
+static const size_t ENUMERATE_SHARDS_PER_THREAD = 16; // Subtrees per worker, so uneven ones even out
+static const size_t ENUMERATE_FLUSH = 1 << 18; // Bytes of solutions a worker collects before writing them out
+
+/// @brief Constructor for the SolutionEnumerator class.
+/// @param puzzle The puzzle, must have consistent givens.
+template<int Box>
+SolutionEnumerator<Box>::SolutionEnumerator(const BasicGrid<Box>& puzzle) : puzzle(puzzle), grid(puzzle){
+}
+
+/// @brief Advances the depth-first search to the next solution. After a solution the deepest frame with digits left
+///         tries its next one; then the search descends, pushing a frame at every branch, until the grid is full or a
+///         dead end sends it back.
+/// @return True with the solution in solution(). False when every solution was returned (done() is then true) or
+///         when the budget of the thread ran out; the position is kept, so next can be called again later.
+template<int Box>
+bool SolutionEnumerator<Box>::next(){
+
+    if(finished){
+        return false;
+    }
+    bool backtrack = at_solution;
+    at_solution = false;
+
+    while(true){
+        if(backtrack){
+            while(depth > 0 && stack[depth - 1].rest == 0){
+                grid.unplace(stack[--depth].cell);
+            }
+            if(depth == 0){
+                finished = true;
+                return false;
+            }
+
+            Frame& frame = stack[depth - 1];
+            grid.unplace(frame.cell);
+            grid.place(frame.cell, __builtin_ctz(frame.rest) + 1);
+            frame.rest &= frame.rest - 1;
+        }
+
+        STAT_ADD(nodes, 1);
+        if(!budget_node()){
+            return false;
+        }
+
+        int cell;
+        Mask choices;
+        if(!grid.best_branch(cell, choices)){
+            backtrack = true;
+            continue;
+        }
+        if(cell == -1){
+            at_solution = true;
+            solutions++;
+            return true;
+        }
+
+        stack[depth++] = {cell, (Mask)(choices & (choices - 1))};
+        grid.place(cell, __builtin_ctz(choices) + 1);
+        backtrack = false;
+    }
+}
+
+/// @brief Returns the position of the enumeration: the digit of every frame from the top of the tree down, in the
+///         one-line symbols, followed by '+' if the current grid was already returned as a solution. The branch cells
+///         are not stored, they follow from the puzzle and the digits above them.
+template<int Box>
+string SolutionEnumerator<Box>::cursor() const{
+
+    if(finished){
+        return "-";
+    }
+    string position;
+    for(int i = 0; i < depth; i++){
+        position += BasicGrid<Box>::symbol(grid.get(stack[i].cell));
+    }
+    if(at_solution){
+        position += '+';
+    }
+    return position;
+}
+
+/// @brief Moves the enumeration to a position written by cursor for the same puzzle, replaying the branches. The
+///         solution count starts again from zero.
+/// @param position The text of cursor, "" for the start and "-" for the end.
+/// @return False if the position does not belong to this puzzle, the enumeration is then back at the start.
+template<int Box>
+bool SolutionEnumerator<Box>::resume(const string& position){
+
+    grid = puzzle;
+    depth = 0;
+    at_solution = false;
+    finished = position == "-";
+    solutions = 0;
+    if(finished){
+        return true;
+    }
+
+    for(size_t i = 0; i < position.size(); i++){
+        if(position[i] == '+' && i + 1 == position.size()){
+            at_solution = true;
+            break;
+        }
+
+        int cell;
+        Mask choices;
+        int val = BasicGrid<Box>::digit(position[i]);
+        if(val <= 0 || !grid.best_branch(cell, choices) || cell == -1 || !(choices & (1u << (val - 1)))){
+            return resume("");
+        }
+        stack[depth++] = {cell, (Mask)(choices & ~((2u << (val - 1)) - 1))};
+        grid.place(cell, val);
+    }
+    return true;
+}
+
+/// @brief Splits the search tree of a puzzle into disjoint subtrees for sharding: the top branches are expanded breadth
+///         first, the way SolutionEnumerator branches, until there are at least shards of them or nothing is left to
+///         expand. Every solution of the puzzle is a solution of exactly one of the subtrees.
+/// @param puzzle The puzzle, must have consistent givens.
+/// @param shards The number of subtrees wanted.
+/// @return The subtrees as grids with the branch digits filled in. Empty if the puzzle has no solution at the top.
+template<int Box>
+vector<BasicGrid<Box>> split_enumeration(const BasicGrid<Box>& puzzle, size_t shards){
+
+    vector<BasicGrid<Box>> leaves; // Complete grids met on the way, nothing left to split
+    deque<BasicGrid<Box>> open = {puzzle};
+
+    while(!open.empty() && open.size() + leaves.size() < shards){
+        BasicGrid<Box> grid = open.front();
+        open.pop_front();
+
+        int cell;
+        typename BasicGrid<Box>::Mask choices;
+        if(!grid.best_branch(cell, choices)){
+            continue;
+        }
+        if(cell == -1){
+            leaves.push_back(grid);
+            continue;
+        }
+        for(typename BasicGrid<Box>::Mask mask = choices; mask != 0; mask &= mask - 1){
+            open.push_back(grid);
+            open.back().place(cell, __builtin_ctz(mask) + 1);
+        }
+    }
+
+    leaves.insert(leaves.end(), open.begin(), open.end());
+    return leaves;
+}
+
+/// @brief Enumerates the solutions of one puzzle on the pool, one task per subtree of split_enumeration. Each task
+///         formats its solutions into a buffer of its own and hands it to the writer under a lock when it fills up, so
+///         the output streams out while the enumeration runs. With one thread the solutions come out in search order,
+///         with more the order of the subtrees varies.
+/// @return The number of solutions written, at most limit when it is not 0.
+template<int Box>
+static uint64_t enumerate_puzzle(const BasicGrid<Box>& puzzle, uint64_t limit, ThreadPool& pool, BufferedWriter& output){
+
+    const int cells = BasicGrid<Box>::CELLS;
+    const uint64_t most = limit ? limit : UINT64_MAX;
+    mutex output_lock;
+    atomic<uint64_t> written{0}; // Solutions claimed by the tasks, can pass most by one per task at the end
+    size_t shard_count = pool.size() > 1 ? pool.size() * ENUMERATE_SHARDS_PER_THREAD : 1;
+    vector<BasicGrid<Box>> shards = split_enumeration(puzzle, shard_count);
+
+    for(const BasicGrid<Box>& shard : shards){
+        pool.submit([&, shard] {
+            SolutionEnumerator<Box> enumerator(shard);
+            vector<char> buffer;
+            buffer.reserve(ENUMERATE_FLUSH + cells + 1);
+
+            while(written.load(memory_order_relaxed) < most && enumerator.next()){
+                if(written.fetch_add(1, memory_order_relaxed) >= most){
+                    break;
+                }
+
+                size_t end = buffer.size();
+                buffer.resize(end + cells + 1);
+                enumerator.solution().format(&buffer[end]);
+                buffer[end + cells] = '\n';
+
+                if(buffer.size() >= ENUMERATE_FLUSH){
+                    lock_guard<mutex> guard(output_lock);
+                    output.write(buffer.data(), buffer.size());
+                    buffer.clear();
+                }
+            }
+            lock_guard<mutex> guard(output_lock);
+            output.write(buffer.data(), buffer.size());
+        });
+    }
+    pool.wait();
+    return min(written.load(), most);
+}
+
+/// @brief Writes every solution of every puzzle of a file, one per line, each puzzle followed by a comment line with
+///         its number of solutions ("# puzzle K: N solutions"). Puzzles go one at a time, each split over the pool.
+///         Invalid puzzles get only the comment line, with 0 solutions.
+/// @param options The input and output files, the number of threads, the box size and the limit per puzzle.
+/// @return The number of puzzles and solutions and the time it took.
+template<int Box>
+static EnumerateResult enumerate_file(const EnumerateOptions& options){
+
+    MappedFile input;
+    BufferedWriter output;
+
+    // Handle invalid text file
+    if(!input.open(options.input)){
+        cerr << "ERROR: Failed to open " << options.input << ", check if file exists and try again." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(!output.open(options.output)){
+        cerr << "ERROR: Failed to open " << options.output << " for writing." << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    EnumerateResult result;
+    LineScanner scanner(input.data(), input.size(), BasicGrid<Box>::CELLS);
+    auto start = chrono::steady_clock::now();
+    {
+        ThreadPool pool(options.threads);
+
+        for(const char* line; (line = scanner.next()) != nullptr;){
+            BasicGrid<Box> puzzle;
+            uint64_t count = puzzle.parse(line) ? enumerate_puzzle(puzzle, options.limit, pool, output) : 0;
+
+            output.write("# puzzle " + to_string(result.puzzles) + ": " + to_string(count) + " solutions\n");
+            result.puzzles++;
+            result.solutions += count;
+        }
+    }
+
+    if(!output.close()){
+        cerr << "ERROR: Failed to write the results." << endl;
+        exit(EXIT_FAILURE);
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+/// @brief Runs enumerate_file for the box size of the options.
+EnumerateResult enumerate_batch(const EnumerateOptions& options){
+    switch(options.box){
+        case 2: return enumerate_file<2>(options);
+        case 4: return enumerate_file<4>(options);
+        case 5: return enumerate_file<5>(options);
+    }
+    return enumerate_file<3>(options);
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef ENUMERATE_H
+#define ENUMERATE_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "grid.hpp"
+
+using namespace std;
+
+/// @brief Lazy enumeration of every solution of a grid, one solution per call to next.
+///         The search runs on an explicit stack of one frame per branching level (the cell and the digits it has not
+///         tried yet), so memory stays the same however many solutions there are, and the enumeration can stop and
+///         pick up again at any point. cursor() writes the position as text, so a later run or another process can
+///         resume from it. Branches where BasicGrid::best_branch says, every search node counts against the budget of
+///         the thread (see budget.hpp); when it runs out next returns false and a later next carries on.
+template<int Box>
+class SolutionEnumerator{
+    public:
+
+        using Mask = typename BasicGrid<Box>::Mask;
+
+        explicit SolutionEnumerator(const BasicGrid<Box>& puzzle); // Starts before the first solution
+
+        bool next(); // Moves to the next solution, false when there are no more or the budget ran out
+        bool done() const { return finished; }
+        const BasicGrid<Box>& solution() const { return grid; } // The current solution, after next returned true
+        uint64_t found() const { return solutions; } // Solutions returned by next so far
+
+        string cursor() const; // Position of the enumeration, see resume
+        bool resume(const string& position); // Moves to a position from cursor, false if it does not fit the puzzle
+
+    private:
+        struct Frame{
+            int cell;
+            Mask rest; // Digits of the cell not tried yet
+        };
+
+        BasicGrid<Box> puzzle;
+        BasicGrid<Box> grid; // The puzzle plus the digit of every frame
+        Frame stack[BasicGrid<Box>::CELLS];
+        int depth = 0;
+        bool at_solution = false; // The grid is the last solution returned, next has to backtrack first
+        bool finished = false;
+        uint64_t solutions = 0;
+};
+
+template<int Box>
+vector<BasicGrid<Box>> split_enumeration(const BasicGrid<Box>& puzzle, size_t shards); // Disjoint subtrees of a search
+
+/// @brief Settings of an enumeration run.
+struct EnumerateOptions{
+    string input; // File with one puzzle per line
+    string output; // File the solutions are written to, empty for standard output
+    unsigned threads = 0; // Worker threads, 0 for one per core
+    int box = 3; // Box size of the puzzles: 2 for 4x4, 3 for 9x9, 4 for 16x16, 5 for 25x25
+    uint64_t limit = 0; // Most solutions per puzzle, 0 for all of them
+};
+
+/// @brief Totals reported after an enumeration run.
+struct EnumerateResult{
+    size_t puzzles = 0;
+    uint64_t solutions = 0;
+    double seconds = 0;
+};
+
+EnumerateResult enumerate_batch(const EnumerateOptions& options); // Writes every solution of every puzzle
+
+#endif
@@ -0,0 +1,369 @@
+#ifndef GENERATOR_CPP
+#define GENERATOR_CPP
+#include "generator.hpp"
+#include "budget.hpp"
+#include "count.hpp"
+#include "io.hpp"
+#include "parallel.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <vector>
+
+static const size_t GENERATE_WINDOW = 1 << 16; // Puzzles generated and written per round, a multiple of GENERATE_CHUNK
+static const size_t GENERATE_CHUNK = 64; // Puzzles per pool task
+static const int TARGET_ATTEMPTS = 5000; // Solutions drawn for one targeted puzzle before giving up on it
+
+// Removal attempts per puzzle by box size: the minimum and the width of the random range on top of it. 9x9 keeps the
+// 30 to 49 of Sudoku::generate. 25x25 stops below half of the cells, past that every uniqueness search takes seconds.
+static const int REMOVALS[6][2] = {{0, 1}, {0, 1}, {6, 4}, {30, 20}, {94, 64}, {230, 70}};
+
+/// @brief Fills a grid with a random solution: the diagonal boxes get shuffled digits, they do not share any row or
+///         column, then the grid is solved. On 9x9 any such fill can be completed; on 4x4 some cannot, so those are
+///         drawn again.
+template<int Box>
+static void fill_solution(Rng& rng, BasicGrid<Box>& grid){
+
+    const int size = BasicGrid<Box>::SIZE;
+    do{
+        grid = BasicGrid<Box>();
+        for(int box = 0; box < size; box += Box + 1){
+            int digits[size];
+            for(int i = 0; i < size; i++){
+                digits[i] = i + 1;
+            }
+            rng.shuffle(digits, size);
+
+            for(int i = 0; i < size; i++){
+                grid.place(UNIT_TABLE<Box>.cells[2 * size + box][i], digits[i]);
+            }
+        }
+    } while(!grid.solve() && !budget_stopped());
+}
+
+/// @brief Generates one puzzle with the same steps as Sudoku::generate: fill the diagonal boxes with shuffled digits,
+///         solve, then try to remove random cells, keeping a removal only if the solution stays unique.
+///         Everything lives on the stack, nothing is allocated.
+/// @param rng The random number generator, the puzzle depends only on its state.
+/// @param puzzle Receives the puzzle.
+/// @param pool If given, every uniqueness check is searched by all of its workers; the puzzle is the same either way.
+///         Must be called from outside the pool.
+template<int Box>
+void generate_puzzle(Rng& rng, BasicGrid<Box>& puzzle, ThreadPool* pool){
+
+    STAT_PHASE(generate_seconds);
+
+    const int cells = BasicGrid<Box>::CELLS;
+    int num_to_remove = rng.below(REMOVALS[Box][1]) + REMOVALS[Box][0];
+
+    fill_solution(rng, puzzle);
+
+    // Remove cells while the solution stays unique. A spent budget ends the generation with the cells removed so far.
+    while(num_to_remove > 0 && !budget_stopped()){
+        int cell = rng.below(cells);
+        int val = puzzle.get(cell);
+
+        if(val != 0){
+            puzzle.unplace(cell);
+            STAT_ADD(uniqueness_checks, 1);
+            int count = pool != nullptr ? count_parallel(puzzle, 2, *pool) : count_solutions(puzzle, 2);
+            if(count != 1){
+                puzzle.place(cell, val); // Restore the removed cell.
+            }
+            num_to_remove--;
+        }
+    }
+}
+
+/// @brief Tells if a 9x9 puzzle has exactly one solution. Singles settle most of the boards the generator asks about,
+///         far cheaper than a search; only the others are counted.
+static bool unique_puzzle(const Grid& puzzle){
+    STAT_ADD(uniqueness_checks, 1);
+    Grade grade = grade_puzzle(puzzle, Difficulty::singles);
+    return (grade.valid && grade.rating == Difficulty::singles) || count_solutions(puzzle, 2) == 1;
+}
+
+/// @brief Generates a 9x9 puzzle with a unique solution, a rating in the band of the options and, if they ask for it,
+///         an exact number of givens. Every attempt draws a solution and removes its cells in a shuffled order. Each
+///         cell is tried once and stays out only if the solution stays unique, so only removals that stick count
+///         towards the givens. Removing a given never makes a puzzle easier, so along that order the rating only grows:
+///          - with a givens target the puzzle is rated once and kept or thrown away,
+///          - otherwise the longest run of removals that stays at or below the band is found by bisection, then the
+///            removals after it are tried one by one and kept while the rating stays in the band. Every puzzle on the
+///            way holds the givens of the last, unique one, so they need no uniqueness check, only a grading capped at
+///            the top of the band.
+///         Attempts that still end below the band are thrown away, at most TARGET_ATTEMPTS of them: a band and givens
+///         that rarely go together would otherwise draw solutions forever.
+/// @param rng The random number generator, the puzzle depends only on its state.
+/// @param puzzle Receives the puzzle.
+/// @param options The rating band and the givens.
+/// @return False if the budget of the thread or the attempts ran out first.
+bool generate_targeted(Rng& rng, Grid& puzzle, const GenerateOptions& options){
+
+    STAT_PHASE(generate_seconds);
+
+    auto rating = [&options](const Grid& grid){
+        return grade_puzzle(grid, min(options.max_rating, Difficulty::chains)).rating;
+    };
+
+    for(int attempt = 0; attempt < TARGET_ATTEMPTS && !budget_stopped(); attempt++){
+        Grid solution;
+        fill_solution(rng, solution);
+        puzzle = solution;
+
+        int order[81];
+        for(int cell = 0; cell < 81; cell++){
+            order[cell] = cell;
+        }
+        rng.shuffle(order, 81);
+
+        int removed[81];
+        int removed_count = 0;
+        for(int i = 0; i < 81 && 81 - removed_count > options.givens && !budget_stopped(); i++){
+            if(options.givens > 0 && i - removed_count > options.givens){
+                break; // Even removing every cell left to try keeps too many givens
+            }
+            int cell = order[i];
+            int val = puzzle.get(cell);
+            puzzle.unplace(cell);
+            if(unique_puzzle(puzzle)){
+                removed[removed_count++] = cell;
+            }
+            else{
+                puzzle.place(cell, val); // Restore the removed cell.
+            }
+        }
+        if(budget_stopped()){
+            break;
+        }
+        if(options.givens > 0){
+            if(81 - removed_count != options.givens){
+                continue;
+            }
+            Difficulty found = rating(puzzle);
+            if(found >= options.min_rating && found <= options.max_rating){
+                return true;
+            }
+            continue;
+        }
+
+        Difficulty found = rating(puzzle);
+        if(found > options.max_rating){
+            // Longest prefix of the removals rated within the top of the band; the empty prefix is the solution.
+            int low = 0;
+            int high = removed_count;
+            while(high - low > 1){
+                int middle = (low + high) / 2;
+                Grid prefix = solution;
+                for(int i = 0; i < middle; i++){
+                    prefix.unplace(removed[i]);
+                }
+                (rating(prefix) <= options.max_rating ? low : high) = middle;
+            }
+
+            puzzle = solution;
+            for(int i = 0; i < low; i++){
+                puzzle.unplace(removed[i]);
+            }
+            found = rating(puzzle);
+            for(int i = low + 1; i < removed_count; i++){
+                puzzle.unplace(removed[i]);
+                Difficulty next = rating(puzzle);
+                if(next > options.max_rating){
+                    puzzle.place(removed[i], solution.get(removed[i]));
+                }
+                else{
+                    found = next;
+                }
+            }
+        }
+        if(found >= options.min_rating && found <= options.max_rating){
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief Generates puzzles first to last - 1 of a run, each into its line of out.
+/// @param options The seed of the run, puzzle i gets its own generator seeded from it and i, and the targets.
+/// @param first The index of the first puzzle.
+/// @param last One past the index of the last puzzle.
+/// @param out Receives one line per puzzle.
+/// @param pool The pool for split uniqueness checks (see generate_puzzle), null when the range runs on a worker.
+/// @return The puzzles given up on, written as lines of dots.
+template<int Box>
+static size_t generate_range(const GenerateOptions& options, size_t first, size_t last, char* out, ThreadPool* pool){
+
+    const int cells = BasicGrid<Box>::CELLS;
+    Rng rng;
+    BasicGrid<Box> puzzle;
+    size_t failed = 0;
+
+    for(size_t i = first; i < last; i++){
+        rng.reseed(options.seed ^ (i * 0xD1B54A32D192ED03ULL));
+        optional<BudgetScope> budget;
+        if(options.budget.limited()){
+            budget.emplace(options.budget);
+        }
+
+        bool generated = true;
+        if constexpr(Box == 3){
+            if(options.targeted()){
+                generated = generate_targeted(rng, puzzle, options);
+            }
+            else{
+                generate_puzzle(rng, puzzle, pool);
+            }
+        }
+        else{
+            generate_puzzle(rng, puzzle, pool);
+        }
+
+        char* line = &out[(i - first) * (cells + 1)];
+        if(generated && !(budget && budget->stopped())){
+            puzzle.format(line);
+        }
+        else{
+            fill(line, line + cells, '.');
+            failed++;
+        }
+        line[cells] = '\n';
+    }
+    return failed;
+}
+
+using RangeGenerator = size_t (*)(const GenerateOptions& options, size_t first, size_t last, char* out,
+                                 ThreadPool* pool);
+
+/// @brief Returns the generate_range instantiation for a box size, 9x9 for any size that is not supported.
+static RangeGenerator range_generator(int box){
+    switch(box){
+        case 2: return generate_range<2>;
+        case 4: return generate_range<4>;
+        case 5: return generate_range<5>;
+    }
+    return generate_range<3>;
+}
+
+/// @brief Generates many puzzles on a work-stealing thread pool. Puzzle i gets its own generator seeded from the run
+///         seed and i, so the output only depends on the seed and is written in index order. The puzzles are made in
+///         windows of GENERATE_WINDOW; each window is written out while the next one is generated, so memory stays
+///         bounded for banks of any size.
+///         A run of fewer large puzzles than workers would leave most of the pool idle behind a few long uniqueness
+///         searches, so it goes like options.split: one puzzle at a time on this thread, every uniqueness check counted
+///         by the whole pool with count_parallel. The puzzles are the same either way. Targeted 9x9 runs are never
+///         split, their checks take microseconds, and neither are runs with a budget, which only counts the nodes of
+///         the thread it is installed on.
+/// @param options The number of puzzles, the seed, the box size, the number of threads, the budget of a puzzle, the
+///         output file and the stats file.
+/// @return The puzzles given up on and the wall time of the run.
+GenerateResult generate_batch(const GenerateOptions& options){
+
+    bool bad_givens = options.givens != 0 && (options.givens < MIN_TARGET_GIVENS || options.givens > 81);
+    if(options.targeted() && (options.box != 3 || bad_givens || options.min_rating > options.max_rating)){
+        cerr << "ERROR: Generation by rating and givens needs 9x9 puzzles, " << MIN_TARGET_GIVENS << " to 81 givens "
+             << "and a band whose lower rating is not above the upper one." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(options.split && options.budget.limited()){
+        cerr << "ERROR: Split generation cannot be combined with a budget." << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    BufferedWriter output;
+    if(!output.open(options.output)){
+        cerr << "ERROR: Failed to open " << options.output << " for writing." << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    RangeGenerator generate = range_generator(options.box);
+    size_t puzzle_line = options.box * options.box * options.box * options.box + 1; // The cells and a newline
+
+    vector<char> windows[2];
+    for(vector<char>& window : windows){
+        window.resize(min(options.count, GENERATE_WINDOW) * puzzle_line);
+    }
+    size_t chunks = (options.count + GENERATE_CHUNK - 1) / GENERATE_CHUNK;
+    vector<SearchStats> chunk_stats(STATS_ENABLED ? chunks : 0);
+    vector<size_t> chunk_failed(chunks, 0);
+
+    GenerateResult result;
+    auto start = chrono::steady_clock::now();
+    {
+        ThreadPool pool(options.threads);
+        bool split = !options.targeted() && !options.budget.limited() &&
+                     (options.split || (options.box >= 4 && options.count < pool.size()));
+        size_t written = 0;
+
+        for(size_t window_first = 0; window_first < options.count; window_first += GENERATE_WINDOW){
+            size_t window_last = min(window_first + GENERATE_WINDOW, options.count);
+            char* out = windows[(window_first / GENERATE_WINDOW) % 2].data();
+
+            if(split){
+                if(STATS_ENABLED){
+                    thread_stats = SearchStats();
+                }
+                chunk_failed[window_first / GENERATE_CHUNK] = generate(options, window_first, window_last, out, &pool);
+                if(STATS_ENABLED){
+                    thread_stats.puzzles = window_last - window_first;
+                    chunk_stats[window_first / GENERATE_CHUNK] = thread_stats;
+                }
+            }
+            for(size_t first = window_first; !split && first < window_last; first += GENERATE_CHUNK){
+                pool.submit([&options, &chunk_stats, &chunk_failed, generate, puzzle_line, out, first, window_first,
+                             window_last] {
+                    size_t last = min(first + GENERATE_CHUNK, window_last);
+
+                    if(STATS_ENABLED){
+                        thread_stats = SearchStats();
+                    }
+
+                    chunk_failed[first / GENERATE_CHUNK] =
+                        generate(options, first, last, &out[(first - window_first) * puzzle_line], nullptr);
+
+                    if(STATS_ENABLED){
+                        thread_stats.puzzles = last - first;
+                        chunk_stats[first / GENERATE_CHUNK] = thread_stats;
+                    }
+                });
+            }
+
+            // Write the previous window while this one is generating.
+            if(written < window_first){
+                output.write(windows[(written / GENERATE_WINDOW) % 2].data(), (window_first - written) * puzzle_line);
+                written = window_first;
+            }
+            pool.wait();
+        }
+        if(written < options.count){
+            output.write(windows[(written / GENERATE_WINDOW) % 2].data(), (options.count - written) * puzzle_line);
+        }
+    }
+
+    if(!output.close()){
+        cerr << "ERROR: Failed to write the puzzles." << endl;
+        exit(EXIT_FAILURE);
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    for(size_t failed : chunk_failed){
+        result.failed += failed;
+    }
+
+    if(!options.stats.empty()){
+        SearchStats stats;
+        for(const SearchStats& chunk : chunk_stats){
+            stats.merge(chunk);
+        }
+        if(!write_stats(options.stats, stats, options.prometheus)){
+            cerr << "ERROR: Failed to open " << options.stats << " for writing." << endl;
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    return result;
+}
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef GENERATOR_H
+#define GENERATOR_H
+#include "budget.hpp"
+#include "grade.hpp"
+#include "grid.hpp"
+#include "rng.hpp"
+#include "stats.hpp"
+#include "thread_pool.hpp"
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+/// @brief Settings for a bulk generation run.
+struct GenerateOptions{
+    size_t count = 0; // Number of puzzles to generate
+    uint64_t seed = 0; // Same seed, same puzzles, whatever the thread count
+    int box = 3; // Box size of the puzzles: 2 for 4x4, 3 for 9x9, 4 for 16x16, 5 for 25x25
+    unsigned threads = 0; // Worker threads, 0 for one per core
+    string output; // File the puzzles are written to, empty for standard output
+    string stats; // File for the aggregated stats, empty for none (needs -DSUDOKU_STATS)
+    bool prometheus = false; // Aggregated stats in the Prometheus text format instead of JSON
+    Difficulty min_rating = Difficulty::singles; // Rating band of the puzzles (see grade_puzzle), 9x9 only
+    Difficulty max_rating = Difficulty::beyond;
+    int givens = 0; // Exact number of givens, 0 for as many as the removals leave, 9x9 only (see MIN_TARGET_GIVENS)
+    bool split = false; // One puzzle at a time, each uniqueness check searched by every thread (see count_parallel)
+    Budget budget; // Limits of every puzzle, one that runs out is written as a line of dots
+
+    bool targeted() const{
+        return givens > 0 || min_rating != Difficulty::singles || max_rating != Difficulty::beyond;
+    }
+};
+
+/// @brief Totals reported after a generation run.
+struct GenerateResult{
+    size_t failed = 0; // Puzzles given up on: out of budget, or no attempt reached the rating and givens
+    double seconds = 0;
+};
+
+// Fewest givens a target may ask for. Removing the cells of a solution once each in a shuffled order stops at 21 or
+// fewer givens in about 1 attempt of 400, at 20 in about 1 of 20000, so lower targets would only spin.
+static const int MIN_TARGET_GIVENS = 21;
+
+template<int Box>
+void generate_puzzle(Rng& rng, BasicGrid<Box>& puzzle, ThreadPool* pool = nullptr); // One puzzle, unique solution
+bool generate_targeted(Rng& rng, Grid& puzzle, const GenerateOptions& options); // A puzzle in the band and givens
+GenerateResult generate_batch(const GenerateOptions& options); // Generates the puzzles in parallel
+
+#endif
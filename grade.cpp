@@ -0,0 +1,671 @@
+#ifndef GRADE_CPP
+#define GRADE_CPP
+#include "grade.hpp"
+#include "budget.hpp"
+#include "io.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+static const size_t GRADE_WINDOW = 1 << 16; // Puzzles read, graded and written per round
+static const size_t GRADE_CHUNK = 256; // Puzzles per pool task
+
+static const char* DIFFICULTY_NAMES[6] = {"singles", "locked", "subsets", "fish", "chains", "beyond"};
+
+/// @brief Maps a name to a rating.
+/// @return True if the name is one of DIFFICULTY_NAMES.
+bool parse_difficulty(const string& name, Difficulty& difficulty){
+    for(int level = 0; level < 6; level++){
+        if(name == DIFFICULTY_NAMES[level]){
+            difficulty = (Difficulty)level;
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief Returns the name parse_difficulty accepts for a rating.
+const char* difficulty_name(Difficulty difficulty){
+    return DIFFICULTY_NAMES[(int)difficulty];
+}
+
+/// @brief The 9-bit masks with 2 and with 3 bits set, the pairs and triples of cells, digits or lines that the subset
+///         and fish techniques try.
+struct SubsetTable{
+    uint16_t pairs[36];
+    uint16_t triples[84];
+
+    constexpr SubsetTable() : pairs(), triples(){
+        int pair = 0;
+        int triple = 0;
+        for(int mask = 0; mask < 512; mask++){
+            int bits = 0;
+            for(int rest = mask; rest != 0; rest &= rest - 1){
+                bits++;
+            }
+            if(bits == 2){
+                pairs[pair++] = mask;
+            }
+            else if(bits == 3){
+                triples[triple++] = mask;
+            }
+        }
+    }
+
+    const uint16_t* begin(int size) const { return size == 2 ? pairs : triples; }
+    const uint16_t* end(int size) const { return size == 2 ? pairs + 36 : triples + 84; }
+};
+
+static constexpr SubsetTable SUBSETS{};
+
+/// @brief Tells if two different cells share a row, column or box.
+static bool sees(int a, int b){
+    return a != b && (a / 9 == b / 9 || a % 9 == b % 9 || box_of<3>(a) == box_of<3>(b));
+}
+
+/*                                                     Board                                                                     */
+
+/// @brief The pencil marks of a person solving a puzzle: the candidates left in every cell. Unlike Grid, eliminations
+///         made by techniques stick, so the candidates of a cell are not just what its peers leave.
+struct GradeBoard{
+    uint16_t cand[81];
+    uint8_t value[81]; // 0 for empty
+    int filled = 0;
+    bool broken = false; // Some cell or unit has no way left, the puzzle has no solution
+
+    bool load(const Grid& puzzle);
+    void place(int cell, int val);
+    bool remove(int cell, uint16_t mask);
+
+    bool naked_singles();
+    bool hidden_singles();
+    bool locked_candidates();
+    bool subsets();
+    bool fish();
+    bool chains();
+
+    private:
+        bool naked_subset(const int* unit, int size);
+        bool hidden_subset(const int* unit, int size);
+        bool fish_of(int val, int size, bool by_rows);
+        bool coloring(int val);
+        bool xy_wing();
+};
+
+/// @brief Sets up the pencil marks of a puzzle.
+/// @return False if an empty cell has no candidate.
+bool GradeBoard::load(const Grid& puzzle){
+    filled = 0;
+    broken = false;
+    for(int cell = 0; cell < 81; cell++){
+        value[cell] = puzzle.get(cell);
+        cand[cell] = value[cell] ? 1u << (value[cell] - 1) : puzzle.candidates(cell);
+        filled += value[cell] != 0;
+        broken = broken || cand[cell] == 0;
+    }
+    return !broken;
+}
+
+/// @brief Fills a cell with one of its candidates and removes the digit from the peers.
+void GradeBoard::place(int cell, int val){
+    uint16_t bit = 1u << (val - 1);
+    value[cell] = val;
+    cand[cell] = bit;
+    filled++;
+    for(int peer : UNITS.peers[cell]){
+        if(value[peer] == 0){
+            remove(peer, bit);
+        }
+        else if(value[peer] == val){
+            broken = true;
+        }
+    }
+}
+
+/// @brief Removes candidates from an empty cell.
+/// @return True if any of them was still there.
+bool GradeBoard::remove(int cell, uint16_t mask){
+    if(value[cell] != 0 || !(cand[cell] & mask)){
+        return false;
+    }
+    cand[cell] &= ~mask;
+    broken = broken || cand[cell] == 0;
+    return true;
+}
+
+/*                                                   Techniques                                                                  */
+
+/// @brief Fills every empty cell that has a single candidate.
+bool GradeBoard::naked_singles(){
+    bool progress = false;
+    for(int cell = 0; cell < 81 && !broken; cell++){
+        if(value[cell] == 0 && (cand[cell] & (cand[cell] - 1)) == 0){
+            place(cell, __builtin_ctz(cand[cell]) + 1);
+            progress = true;
+        }
+    }
+    return progress;
+}
+
+/// @brief Fills every cell that holds the only place of a digit in one of its units.
+bool GradeBoard::hidden_singles(){
+    bool progress = false;
+    for(int unit = 0; unit < 27 && !broken; unit++){
+        const int* cells = UNITS.cells[unit];
+        uint16_t once = 0;
+        uint16_t twice = 0;
+        uint16_t placed = 0;
+        for(int i = 0; i < 9; i++){
+            if(value[cells[i]]){
+                placed |= cand[cells[i]];
+                continue;
+            }
+            twice |= once & cand[cells[i]];
+            once |= cand[cells[i]];
+        }
+        if((once | placed) != Grid::ALL){
+            broken = true;
+            break;
+        }
+        for(uint16_t single = once & ~twice & ~placed; single != 0; single &= single - 1){
+            uint16_t bit = single & -single;
+            for(int i = 0; i < 9; i++){
+                if(value[cells[i]] == 0 && (cand[cells[i]] & bit)){
+                    place(cells[i], __builtin_ctz(bit) + 1);
+                    progress = true;
+                    break;
+                }
+            }
+        }
+    }
+    return progress;
+}
+
+/// @brief Pointing: a digit whose places in a box share a row or column is removed from the rest of that line.
+///         Claiming: a digit whose places in a row or column share a box is removed from the rest of that box.
+bool GradeBoard::locked_candidates(){
+    bool progress = false;
+    for(int unit = 0; unit < 27; unit++){
+        const int* cells = UNITS.cells[unit];
+
+        for(int val = 1; val <= 9; val++){
+            uint16_t bit = 1u << (val - 1);
+            int rows = 0;
+            int columns = 0;
+            int boxes = 0;
+            int count = 0;
+            for(int i = 0; i < 9; i++){
+                if(value[cells[i]] == 0 && (cand[cells[i]] & bit)){
+                    rows |= 1 << (cells[i] / 9);
+                    columns |= 1 << (cells[i] % 9);
+                    boxes |= 1 << box_of<3>(cells[i]);
+                    count++;
+                }
+            }
+            if(count < 2){
+                continue;
+            }
+
+            // The other unit all the places share: a line for a box, a box for a line.
+            const int* other = nullptr;
+            if(unit >= 18 && __builtin_popcount(rows) == 1){
+                other = UNITS.cells[__builtin_ctz(rows)];
+            }
+            else if(unit >= 18 && __builtin_popcount(columns) == 1){
+                other = UNITS.cells[9 + __builtin_ctz(columns)];
+            }
+            else if(unit < 18 && __builtin_popcount(boxes) == 1){
+                other = UNITS.cells[18 + __builtin_ctz(boxes)];
+            }
+            for(int i = 0; other != nullptr && i < 9; i++){
+                if(find(cells, cells + 9, other[i]) == cells + 9){
+                    progress |= remove(other[i], bit);
+                }
+            }
+        }
+    }
+    return progress;
+}
+
+/// @brief Naked subsets: size empty cells of a unit whose candidates together are size digits. Those digits are
+///         removed from the other cells of the unit.
+bool GradeBoard::naked_subset(const int* unit, int size){
+
+    uint16_t empty = 0;
+    for(int i = 0; i < 9; i++){
+        empty |= (value[unit[i]] == 0) << i;
+    }
+    if(__builtin_popcount(empty) <= size){
+        return false;
+    }
+
+    bool progress = false;
+    for(const uint16_t* pick = SUBSETS.begin(size); pick != SUBSETS.end(size); pick++){
+        if((*pick & empty) != *pick){
+            continue;
+        }
+        uint16_t digits = 0;
+        for(uint16_t rest = *pick; rest != 0; rest &= rest - 1){
+            digits |= cand[unit[__builtin_ctz(rest)]];
+        }
+        if(__builtin_popcount(digits) != size){
+            continue;
+        }
+        for(int i = 0; i < 9; i++){
+            if(!(*pick & (1 << i))){
+                progress |= remove(unit[i], digits);
+            }
+        }
+    }
+    return progress;
+}
+
+/// @brief Hidden subsets: size digits whose places in a unit are size cells. Those cells lose their other candidates.
+bool GradeBoard::hidden_subset(const int* unit, int size){
+
+    uint16_t places[9] = {0}; // Positions in the unit of every digit
+    for(int i = 0; i < 9; i++){
+        if(value[unit[i]] != 0){
+            continue;
+        }
+        for(uint16_t mask = cand[unit[i]]; mask != 0; mask &= mask - 1){
+            places[__builtin_ctz(mask)] |= 1 << i;
+        }
+    }
+
+    bool progress = false;
+    for(const uint16_t* pick = SUBSETS.begin(size); pick != SUBSETS.end(size); pick++){
+        uint16_t digits = *pick;
+        uint16_t positions = 0;
+        bool placed = true;
+        for(uint16_t rest = digits; rest != 0; rest &= rest - 1){
+            positions |= places[__builtin_ctz(rest)];
+            placed = placed && places[__builtin_ctz(rest)] != 0;
+        }
+        if(!placed || __builtin_popcount(positions) != size){
+            continue;
+        }
+        for(int i = 0; i < 9; i++){
+            if(positions & (1 << i)){
+                progress |= remove(unit[i], Grid::ALL & ~digits);
+            }
+        }
+    }
+    return progress;
+}
+
+/// @brief Naked and hidden pairs, then triples, in every unit.
+bool GradeBoard::subsets(){
+    for(int size = 2; size <= 3; size++){
+        bool progress = false;
+        for(int unit = 0; unit < 27; unit++){
+            progress |= naked_subset(UNITS.cells[unit], size);
+            progress |= hidden_subset(UNITS.cells[unit], size);
+        }
+        if(progress){
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief Basic fish of a digit: size rows (or columns) whose places of the digit lie in the same size columns (or
+///         rows). The digit is removed from those columns (or rows) outside the base lines.
+bool GradeBoard::fish_of(int val, int size, bool by_rows){
+
+    uint16_t bit = 1u << (val - 1);
+    uint16_t places[9]; // Cover lines of the digit in every base line
+    for(int line = 0; line < 9; line++){
+        places[line] = 0;
+        for(int i = 0; i < 9; i++){
+            int cell = by_rows ? line * 9 + i : i * 9 + line;
+            if(value[cell] == 0 && (cand[cell] & bit)){
+                places[line] |= 1 << i;
+            }
+        }
+    }
+
+    bool progress = false;
+    for(const uint16_t* pick = SUBSETS.begin(size); pick != SUBSETS.end(size); pick++){
+        uint16_t base = *pick;
+        uint16_t cover = 0;
+        bool open = true;
+        for(int line = 0; line < 9; line++){
+            if(base & (1 << line)){
+                cover |= places[line];
+                open = open && places[line] != 0;
+            }
+        }
+        if(!open || __builtin_popcount(cover) != size){
+            continue;
+        }
+        for(int line = 0; line < 9; line++){
+            if(base & (1 << line)){
+                continue;
+            }
+            for(uint16_t rest = cover & places[line]; rest != 0; rest &= rest - 1){
+                int i = __builtin_ctz(rest);
+                progress |= remove(by_rows ? line * 9 + i : i * 9 + line, bit);
+            }
+        }
+    }
+    return progress;
+}
+
+/// @brief X-wings, then swordfish, on rows and on columns.
+bool GradeBoard::fish(){
+    for(int size = 2; size <= 3; size++){
+        bool progress = false;
+        for(int val = 1; val <= 9; val++){
+            progress |= fish_of(val, size, true);
+            progress |= fish_of(val, size, false);
+        }
+        if(progress){
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief Simple coloring of a digit: the cells linked by conjugate pairs (the only two places of the digit in a unit)
+///         alternate between holding it and not. If two cells of one color see each other, that color is false; a cell
+///         that sees both colors of a chain cannot hold the digit.
+bool GradeBoard::coloring(int val){
+
+    uint16_t bit = 1u << (val - 1);
+    int8_t color[81]; // 0 or 1 within a chain, -1 outside any chain
+    int chain[81];
+    fill(color, color + 81, -1);
+    fill(chain, chain + 81, -1);
+
+    // Conjugate pairs of the digit.
+    int pairs[27][2];
+    int pair_count = 0;
+    for(int unit = 0; unit < 27; unit++){
+        int found = 0;
+        for(int i = 0; i < 9 && found <= 2; i++){
+            int cell = UNITS.cells[unit][i];
+            if(value[cell] == 0 && (cand[cell] & bit)){
+                if(found < 2){
+                    pairs[pair_count][found] = cell;
+                }
+                found++;
+            }
+        }
+        pair_count += found == 2;
+    }
+
+    // Color every chain by walking its pairs until no cell gets a color.
+    int chains = 0;
+    for(int start = 0; start < pair_count; start++){
+        if(color[pairs[start][0]] != -1){
+            continue;
+        }
+        color[pairs[start][0]] = 0;
+        chain[pairs[start][0]] = chains;
+        for(bool grown = true; grown;){
+            grown = false;
+            for(int p = 0; p < pair_count; p++){
+                for(int side = 0; side < 2; side++){
+                    int from = pairs[p][side];
+                    int to = pairs[p][1 - side];
+                    if(chain[from] == chains && color[to] == -1){
+                        color[to] = 1 - color[from];
+                        chain[to] = chains;
+                        grown = true;
+                    }
+                }
+            }
+        }
+        chains++;
+    }
+
+    bool progress = false;
+    for(int id = 0; id < chains; id++){
+        // Wrap: two cells of the same color in one unit.
+        int wrong = -1;
+        for(int a = 0; a < 81 && wrong == -1; a++){
+            for(int b = a + 1; b < 81 && chain[a] == id; b++){
+                if(chain[b] == id && color[a] == color[b] && sees(a, b)){
+                    wrong = color[a];
+                    break;
+                }
+            }
+        }
+        if(wrong != -1){
+            for(int cell = 0; cell < 81; cell++){
+                if(chain[cell] == id && color[cell] == wrong){
+                    progress |= remove(cell, bit);
+                }
+            }
+            continue;
+        }
+
+        // Trap: a cell outside the chain that sees both colors.
+        for(int cell = 0; cell < 81; cell++){
+            if(value[cell] != 0 || !(cand[cell] & bit) || chain[cell] == id){
+                continue;
+            }
+            bool seen[2] = {false, false};
+            for(int peer : UNITS.peers[cell]){
+                if(chain[peer] == id){
+                    seen[color[peer]] = true;
+                }
+            }
+            if(seen[0] && seen[1]){
+                progress |= remove(cell, bit);
+            }
+        }
+    }
+    return progress;
+}
+
+/// @brief XY-wing: a pivot with candidates {a, b} sees a pincer {a, c} and a pincer {b, c}. Whatever the pivot holds,
+///         one pincer holds c, so c is removed from every cell that sees both pincers.
+bool GradeBoard::xy_wing(){
+
+    bool progress = false;
+    for(int pivot = 0; pivot < 81; pivot++){
+        if(value[pivot] != 0 || __builtin_popcount(cand[pivot]) != 2){
+            continue;
+        }
+        for(int first : UNITS.peers[pivot]){
+            uint16_t shared = cand[first] & cand[pivot];
+            if(value[first] != 0 || __builtin_popcount(cand[first]) != 2 || __builtin_popcount(shared) != 1){
+                continue;
+            }
+            uint16_t c = cand[first] & ~shared;
+            uint16_t wanted = (cand[pivot] & ~shared) | c; // The other pincer: the other pivot digit and c
+
+            for(int second : UNITS.peers[pivot]){
+                if(value[second] != 0 || cand[second] != wanted || sees(first, second)){
+                    continue;
+                }
+                for(int cell = 0; cell < 81; cell++){
+                    if(cell != pivot && sees(cell, first) && sees(cell, second)){
+                        progress |= remove(cell, c);
+                    }
+                }
+            }
+        }
+    }
+    return progress;
+}
+
+/// @brief Simple coloring of every digit, then XY-wings.
+bool GradeBoard::chains(){
+    bool progress = false;
+    for(int val = 1; val <= 9; val++){
+        progress |= coloring(val);
+    }
+    return progress || xy_wing();
+}
+
+/*                                                     Grader                                                                    */
+
+/// @brief Rates a puzzle by the hardest technique its logical solution needs.
+/// @param puzzle The puzzle, must have consistent givens.
+/// @param ceiling The hardest technique to try. A puzzle that needs a harder one is rated beyond as soon as the easier
+///         ones stall, which makes the question "is it at most this hard" cheap.
+/// @return The rating and the number of steps; invalid if the techniques reach a contradiction, which they only do
+///         on a puzzle without a solution.
+Grade grade_puzzle(const Grid& puzzle, Difficulty ceiling){
+
+    GradeBoard board;
+    Grade grade;
+    grade.valid = board.load(puzzle);
+
+    while(grade.valid && board.filled < 81){
+        if(!budget_node()){
+            grade.rating = Difficulty::beyond;
+            break;
+        }
+
+        Difficulty used;
+        if(board.naked_singles() || board.hidden_singles()){
+            used = Difficulty::singles;
+        }
+        else if(ceiling >= Difficulty::locked && board.locked_candidates()){
+            used = Difficulty::locked;
+        }
+        else if(ceiling >= Difficulty::subsets && board.subsets()){
+            used = Difficulty::subsets;
+        }
+        else if(ceiling >= Difficulty::fish && board.fish()){
+            used = Difficulty::fish;
+        }
+        else if(ceiling >= Difficulty::chains && board.chains()){
+            used = Difficulty::chains;
+        }
+        else{
+            grade.rating = Difficulty::beyond;
+            break;
+        }
+
+        grade.valid = !board.broken;
+        grade.rating = max(grade.rating, used);
+        grade.steps++;
+    }
+    return grade;
+}
+
+/*                                                 Batch grading                                                                 */
+
+/// @brief One window of puzzles: the lines, the rating lines and the totals of every chunk.
+struct GradeWindow{
+    vector<const char*> lines;
+    vector<vector<char>> out; // Rating lines per chunk
+    vector<GradeResult> totals; // Counts per chunk
+};
+
+/// @brief Rates every puzzle of a file on the thread pool, in windows like solve_batch: one window is graded while the
+///         ratings of the previous one are written. Every puzzle gets a line "LEVEL NAME", the level 0 (singles) to 5
+///         (beyond) first so a bank pasted next to its ratings sorts by difficulty, or "invalid" for a line that is not
+///         a puzzle or whose givens contradict each other.
+/// @param options The input and output files and the number of threads.
+/// @return The count of every rating and the time it took.
+GradeResult grade_batch(const GradeOptions& options){
+
+    MappedFile input;
+    BufferedWriter output;
+
+    // Handle invalid text file
+    if(!input.open(options.input)){
+        cerr << "ERROR: Failed to open " << options.input << ", check if file exists and try again." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(!output.open(options.output)){
+        cerr << "ERROR: Failed to open " << options.output << " for writing." << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    LineScanner scanner(input.data(), input.size());
+    GradeResult result;
+    GradeWindow windows[2];
+
+    auto start = chrono::steady_clock::now();
+    {
+        ThreadPool pool(options.threads);
+
+        GradeWindow* grading = &windows[0];
+        GradeWindow* writing = nullptr;
+
+        while(true){
+            GradeWindow& window = *grading;
+
+            window.lines.clear();
+            for(const char* line; window.lines.size() < GRADE_WINDOW && (line = scanner.next()) != nullptr;){
+                window.lines.push_back(line);
+            }
+            result.puzzles += window.lines.size();
+
+            size_t chunks = (window.lines.size() + GRADE_CHUNK - 1) / GRADE_CHUNK;
+            window.out.resize(chunks);
+            window.totals.assign(chunks, GradeResult());
+
+            for(size_t chunk = 0; chunk < chunks; chunk++){
+                pool.submit([&window, chunk] {
+                    size_t first = chunk * GRADE_CHUNK;
+                    size_t last = min(first + GRADE_CHUNK, window.lines.size());
+                    vector<char>& out = window.out[chunk];
+                    GradeResult& totals = window.totals[chunk];
+                    out.clear();
+
+                    for(size_t i = first; i < last; i++){
+                        Grid puzzle;
+                        Grade grade;
+                        grade.valid = puzzle.parse(window.lines[i]);
+                        if(grade.valid){
+                            grade = grade_puzzle(puzzle);
+                        }
+
+                        string line = grade.valid ? to_string((int)grade.rating) + " " +
+                                                    difficulty_name(grade.rating) + "\n"
+                                                  : string("invalid\n");
+                        out.insert(out.end(), line.begin(), line.end());
+                        if(grade.valid){
+                            totals.counts[(int)grade.rating]++;
+                        }
+                        else{
+                            totals.invalid++;
+                        }
+                    }
+                });
+            }
+
+            // Write the previous window while this one is graded.
+            if(writing != nullptr){
+                for(const vector<char>& out : writing->out){
+                    output.write(out.data(), out.size());
+                }
+            }
+
+            pool.wait();
+
+            for(const GradeResult& totals : window.totals){
+                for(int level = 0; level < 6; level++){
+                    result.counts[level] += totals.counts[level];
+                }
+                result.invalid += totals.invalid;
+            }
+
+            if(window.lines.empty()){
+                break;
+            }
+            writing = grading;
+            grading = (grading == &windows[0]) ? &windows[1] : &windows[0];
+        }
+    }
+
+    if(!output.close()){
+        cerr << "ERROR: Failed to write the results." << endl;
+        exit(EXIT_FAILURE);
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+#endif
@@ -0,0 +1,55 @@
+#ifndef GRADE_H
+#define GRADE_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "grid.hpp"
+
+using namespace std;
+
+/// @brief Ratings of the grader, by the hardest human technique a puzzle needs. Each level includes the ones below.
+enum class Difficulty : uint8_t{
+    singles, // Naked and hidden singles
+    locked, // Locked candidates: pointing and claiming
+    subsets, // Naked and hidden pairs and triples
+    fish, // X-wing and swordfish
+    chains, // Short chains: simple coloring and XY-wing
+    beyond // Needs more than the grader knows, or guessing
+};
+
+bool parse_difficulty(const string& name, Difficulty& difficulty); // Maps a name to a rating, false if unknown
+const char* difficulty_name(Difficulty difficulty); // "singles", "locked", "subsets", "fish", "chains" or "beyond"
+
+/// @brief What the grader found out about a puzzle.
+struct Grade{
+    bool valid = true; // False if the givens contradict each other, the other fields then mean nothing
+    Difficulty rating = Difficulty::singles;
+    int steps = 0; // Technique applications, each one places digits or removes candidates
+};
+
+/// @brief Rates a puzzle by solving it the way a person would: every step applies the easiest technique that makes
+///         progress, and the rating is the hardest technique applied. Every step removes at least one candidate, so a
+///         puzzle takes at most 729 steps, each a fixed number of passes over the board; a puzzle the techniques cannot
+///         finish is rated beyond as soon as they stall. Each step also counts as a node of the budget of the calling
+///         thread (see BudgetScope), a spent budget rates the puzzle beyond. A board the techniques fill completely has
+///         exactly one solution, so a rating below beyond also proves the puzzle unique.
+Grade grade_puzzle(const Grid& puzzle, Difficulty ceiling = Difficulty::chains);
+
+/// @brief Settings for grading a file of puzzles.
+struct GradeOptions{
+    string input; // File with one 9x9 puzzle per line
+    string output; // File the ratings are written to, empty for standard output
+    unsigned threads = 0; // Worker threads, 0 for one per core
+};
+
+/// @brief Totals reported after grading a file.
+struct GradeResult{
+    size_t puzzles = 0;
+    size_t counts[6] = {0}; // Puzzles of every rating
+    size_t invalid = 0; // Lines that are not a puzzle or whose givens contradict each other
+    double seconds = 0;
+};
+
+GradeResult grade_batch(const GradeOptions& options); // Writes "LEVEL NAME" for every puzzle, in order
+
+#endif
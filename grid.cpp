@@ -0,0 +1,275 @@
+#ifndef GRID_CPP
+#define GRID_CPP
+#include "grid.hpp"
+#include "budget.hpp"
+#include "propagate.hpp"
+
+/// @brief Constructor for the BasicGrid class, every cell starts empty and every digit is a candidate everywhere.
+template<int Box>
+BasicGrid<Box>::BasicGrid(){
+    for(int cell = 0; cell < CELLS; cell++){
+        cells[cell] = 0;
+    }
+    for(int unit = 0; unit < SIZE; unit++){
+        rows[unit] = 0;
+        columns[unit] = 0;
+        boxes[unit] = 0;
+    }
+}
+
+/// @brief Copies the values of a board into the grid and builds the row, column and box masks.
+/// @param curr_board The board to load, 0 for empty cells.
+/// @return True if the givens are consistent, false if a digit is out of range or repeated in a row, column or box.
+template<int Box>
+bool BasicGrid<Box>::load(int curr_board[SIZE][SIZE]){
+
+    *this = BasicGrid();
+
+    for(int cell = 0; cell < CELLS; cell++){
+        int val = curr_board[row_of<Box>(cell)][column_of<Box>(cell)];
+
+        if(val != 0){
+            if(val < 0 || val > SIZE || !(candidates(cell) & (1u << (val - 1)))){
+                return false;
+            }
+            place(cell, val);
+        }
+    }
+    return true;
+}
+
+/// @brief Writes the grid values back into a board.
+/// @param curr_board The board to write to.
+template<int Box>
+void BasicGrid<Box>::store(int curr_board[SIZE][SIZE]) const{
+    for(int cell = 0; cell < CELLS; cell++){
+        curr_board[row_of<Box>(cell)][column_of<Box>(cell)] = cells[cell];
+    }
+}
+
+/// @brief Reads a puzzle in the common one-line format: CELLS characters in row-major order, see symbol for the
+///         givens and '.' or '0' for blanks. For 9x9 that is 81 characters of '1'..'9'.
+/// @param text Points at the first of the CELLS characters, it does not need to be null terminated.
+/// @return True if all CELLS characters are valid and the givens are consistent.
+template<int Box>
+bool BasicGrid<Box>::parse(const char* text){
+
+    *this = BasicGrid();
+
+    for(int cell = 0; cell < CELLS; cell++){
+        int val = digit(text[cell]);
+
+        if(val == 0){
+            continue;
+        }
+        if(val < 0 || !(candidates(cell) & (1u << (val - 1)))){
+            return false;
+        }
+        place(cell, val);
+    }
+    return true;
+}
+
+/// @brief Writes the grid in the one-line format, '.' for blanks. No newline or terminator is added.
+/// @param text Receives exactly CELLS characters.
+template<int Box>
+void BasicGrid<Box>::format(char* text) const{
+    for(int cell = 0; cell < CELLS; cell++){
+        text[cell] = cells[cell] ? symbol(cells[cell]) : '.';
+    }
+}
+
+/// @brief Returns the character of a digit: '1'..'9', then 'A' for 10, 'B' for 11 and so on up to 'P' for 25.
+template<int Box>
+char BasicGrid<Box>::symbol(int val){
+    return val < 10 ? '0' + val : 'A' + (val - 10);
+}
+
+/// @brief Returns the digit of a character, the inverse of symbol. Letters may be upper or lower case.
+/// @return The digit, 0 for a blank ('.' or '0'), or -1 if the character is not a digit of this board size.
+template<int Box>
+int BasicGrid<Box>::digit(char c){
+
+    int val = -1;
+    if(c == '.' || c == '0'){
+        return 0;
+    }
+    if(c >= '1' && c <= '9'){
+        val = c - '0';
+    }
+    else if(c >= 'A' && c <= 'Z'){
+        val = c - 'A' + 10;
+    }
+    else if(c >= 'a' && c <= 'z'){
+        val = c - 'a' + 10;
+    }
+    return val <= SIZE ? val : -1;
+}
+
+/// @brief Places a value in an empty cell. The caller is responsible for checking that val is a candidate.
+/// @param cell The cell index in row-major order.
+/// @param val The value to place, 1..SIZE.
+template<int Box>
+void BasicGrid<Box>::place(int cell, int val){
+    Mask bit = (Mask)(1u << (val - 1));
+
+    cells[cell] = val;
+    rows[row_of<Box>(cell)] |= bit;
+    columns[column_of<Box>(cell)] |= bit;
+    boxes[box_of<Box>(cell)] |= bit;
+}
+
+/// @brief Removes the value of a filled cell and gives the digit back to its row, column and box.
+/// @param cell The cell index in row-major order.
+template<int Box>
+void BasicGrid<Box>::unplace(int cell){
+    Mask bit = (Mask)~(1u << (cells[cell] - 1));
+
+    cells[cell] = 0;
+    rows[row_of<Box>(cell)] &= bit;
+    columns[column_of<Box>(cell)] &= bit;
+    boxes[box_of<Box>(cell)] &= bit;
+}
+
+/// @brief Finds the first empty cell in row-major order, starting the scan at from.
+/// @param from The cell index the scan starts at.
+/// @return The index of the empty cell, or -1 if every cell from there on is filled.
+template<int Box>
+int BasicGrid<Box>::find_empty(int from) const{
+    for(int cell = from; cell < CELLS; cell++){
+        if(cells[cell] == 0){
+            return cell;
+        }
+    }
+    return -1;
+}
+
+/// @brief Picks where the search branches next on the boards other than 9x9: a hidden single (a digit with one place
+///         left in a unit) if there is one, otherwise the empty cell with the fewest candidates.
+/// @param cell Receives the cell, or -1 if the grid is full.
+/// @param choices Receives the digits to try in that cell.
+/// @return False if the grid is a dead end: an empty cell without candidates or a unit digit without a place.
+template<int Box>
+bool BasicGrid<Box>::best_branch(int& cell, Mask& choices) const{
+
+    cell = -1;
+    int best_count = SIZE + 1;
+
+    for(int i = 0; i < CELLS; i++){
+        if(cells[i] == 0){
+            int count = __builtin_popcount(candidates(i));
+            if(count < best_count){
+                cell = i;
+                best_count = count;
+                if(count <= 1){
+                    choices = candidates(i);
+                    return count == 1;
+                }
+            }
+        }
+    }
+    if(cell == -1){
+        return true;
+    }
+
+    // Every digit needs a place in every unit, and a digit with a single place is forced there.
+    for(int unit = 0; unit < Traits::UNITS; unit++){
+        const Mask* placed = unit < SIZE ? rows : unit < 2 * SIZE ? columns : boxes;
+        Mask once = placed[unit % SIZE];
+        Mask twice = 0;
+
+        for(int i : UNIT_TABLE<Box>.cells[unit]){
+            if(cells[i] == 0){
+                Mask mask = candidates(i);
+                twice |= once & mask;
+                once |= mask;
+            }
+        }
+        if(once != ALL){
+            return false;
+        }
+
+        Mask single = once & ~twice & ~placed[unit % SIZE];
+        if(single != 0){
+            choices = single & -single;
+            for(int i : UNIT_TABLE<Box>.cells[unit]){
+                if(cells[i] == 0 && (candidates(i) & choices)){
+                    cell = i;
+                    return true;
+                }
+            }
+        }
+    }
+
+    choices = candidates(cell);
+    return true;
+}
+
+/// @brief Solves the grid in place. On 9x9, constraint propagation fills the forced cells first, then the search runs
+///         in the same order as the original board scan (first empty cell, digits 1 to 9). Propagation never removes a
+///         solution, so the first solution found is the same one. The other sizes branch where best_branch says
+///         instead, as a first-empty scan does not finish on the larger boards.
+/// @return True if a solution was found, otherwise false and the grid is left as it was.
+template<int Box>
+bool BasicGrid<Box>::solve(){
+
+    if constexpr(Box == 3){
+        Propagator propagator;
+
+        if(propagator.run(*this) && solve_helper(0)){
+            return true;
+        }
+
+        // Take the propagated digits back out.
+        for(int i = propagator.placed() - 1; i >= 0; i--){
+            unplace(propagator.placed_cell(i));
+        }
+        return false;
+    }
+    else{
+        return solve_helper(0);
+    }
+}
+
+/// @brief Recursive backtracking over the candidate masks. On 9x9, cells before from are known to be filled, so the
+///         scan for the next empty cell continues where the parent call stopped.
+/// @param from The cell index to start looking for an empty cell.
+/// @return True if the remaining cells were solved, otherwise false, also once the budget of the thread is spent.
+template<int Box>
+bool BasicGrid<Box>::solve_helper(int from){
+
+    STAT_ADD(nodes, 1);
+    STAT_DEPTH();
+
+    if(!budget_node()){
+        return false;
+    }
+
+    int cell;
+    Mask choices;
+    if constexpr(Box == 3){
+        cell = find_empty(from);
+        choices = cell == -1 ? 0 : candidates(cell);
+    }
+    else if(!best_branch(cell, choices)){
+        return false;
+    }
+    if(cell == -1){
+        return true; // Puzzle is solved when there are no more empty cells.
+    }
+
+    // Try each legal digit from the lowest bit up.
+    for(Mask mask = choices; mask != 0; mask &= mask - 1){
+        place(cell, __builtin_ctz(mask) + 1);
+        STAT_ADD(candidates_tried, 1);
+
+        if(solve_helper(cell + 1)){
+            return true;
+        }
+        unplace(cell); // Backtrack by resetting the cell value.
+        STAT_ADD(backtracks, 1);
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef GRID_H
+#define GRID_H
+#include <cstdint>
+#include <type_traits>
+#include "stats.hpp"
+
+using namespace std;
+
+/// @brief Sizes and types of a board with Box x Box boxes: 2 for 4x4, 3 for the classic 9x9, 4 for 16x16 and 5 for
+///         25x25. The candidate mask is the smallest unsigned type with one bit per digit.
+template<int Box>
+struct BoardTraits{
+    static constexpr int BOX = Box;
+    static constexpr int SIZE = Box * Box; // Digits, and cells per row, column and box
+    static constexpr int CELLS = SIZE * SIZE;
+    static constexpr int UNITS = 3 * SIZE;
+    static constexpr int PEERS = 2 * (SIZE - 1) + (Box - 1) * (Box - 1);
+
+    using Mask = conditional_t<(SIZE <= 8), uint8_t, conditional_t<(SIZE <= 16), uint16_t, uint32_t>>;
+    static constexpr Mask ALL = (Mask)((1ULL << SIZE) - 1); // Mask with every digit set
+};
+
+// Cells are indexed in row-major order. A digit d is stored in the masks as bit (d - 1).
+template<int Box = 3>
+inline constexpr int row_of(int cell) { return cell / (Box * Box); }
+template<int Box = 3>
+inline constexpr int column_of(int cell) { return cell % (Box * Box); }
+template<int Box = 3>
+inline constexpr int box_of(int cell) { return (cell / (Box * Box * Box)) * Box + (cell % (Box * Box)) / Box; }
+
+/// @brief Unit and peer tables built at compile time. Units 0..SIZE-1 are the rows, then the columns, then the boxes.
+template<int Box>
+struct BasicUnitTable{
+    using Traits = BoardTraits<Box>;
+
+    int cells[Traits::UNITS][Traits::SIZE]; // Cells of every unit
+    int peers[Traits::CELLS][Traits::PEERS]; // The other cells that share a row, column or box with a cell
+
+    constexpr BasicUnitTable() : cells(), peers(){
+        const int size = Traits::SIZE;
+
+        for(int i = 0; i < size; i++){
+            for(int j = 0; j < size; j++){
+                cells[i][j] = i * size + j;
+                cells[size + i][j] = j * size + i;
+                cells[2 * size + i][j] = ((i / Box) * Box + j / Box) * size + (i % Box) * Box + j % Box;
+            }
+        }
+        for(int cell = 0; cell < Traits::CELLS; cell++){
+            int count = 0;
+            for(int other = 0; other < Traits::CELLS; other++){
+                if(other != cell && (row_of<Box>(other) == row_of<Box>(cell) ||
+                                     column_of<Box>(other) == column_of<Box>(cell) ||
+                                     box_of<Box>(other) == box_of<Box>(cell))){
+                    peers[cell][count++] = other;
+                }
+            }
+        }
+    }
+};
+
+template<int Box>
+inline constexpr BasicUnitTable<Box> UNIT_TABLE{};
+
+inline constexpr const BasicUnitTable<3>& UNITS = UNIT_TABLE<3>; // Tables of the classic 9x9 board
+
+/// @brief Bitmask candidate engine used by the solver, for any box size.
+///         Keeps one occupancy mask per row, column and box that is updated on every place/unplace, so the legal
+///         candidates of a cell are a single OR/NOT and iterating them is a count-trailing-zeros loop. Every size is
+///         its own instantiation, so the loops run over compile-time bounds with the narrowest mask type.
+template<int Box>
+class BasicGrid{
+    public:
+
+        using Traits = BoardTraits<Box>;
+        using Mask = typename Traits::Mask;
+
+        static constexpr int SIZE = Traits::SIZE;
+        static constexpr int CELLS = Traits::CELLS;
+        static constexpr Mask ALL = Traits::ALL;
+
+        BasicGrid(); // Constructor, creates an empty grid
+
+        bool load(int curr_board[SIZE][SIZE]); // Copies a board into the grid, false if the givens repeat a digit
+        void store(int curr_board[SIZE][SIZE]) const; // Copies the grid back into a board
+        bool parse(const char* text); // Reads CELLS characters, '.' or '0' for blanks, false on bad input or repeats
+        void format(char* text) const; // Writes the CELLS digits, '.' for blanks
+
+        void place(int cell, int val); // Puts val in an empty cell and updates the masks
+        void unplace(int cell); // Clears a filled cell and updates the masks
+
+        int get(int cell) const { return cells[cell]; }
+        Mask candidates(int cell) const {
+            return ALL & ~(rows[row_of<Box>(cell)] | columns[column_of<Box>(cell)] | boxes[box_of<Box>(cell)]);
+        }
+        int find_empty(int from = 0) const; // First empty cell at or after from, -1 if the grid is full
+        bool best_branch(int& cell, Mask& choices) const; // Cell and digits to branch on next, false on a dead end
+
+        bool solve(); // Solves in place, see the definition for the search order of each size
+
+        static char symbol(int val); // Character of a digit: 1..9, then A, B, ... for the larger boards
+        static int digit(char c); // Digit of a character, 0 for a blank, -1 if it is not a digit of this size
+
+    private:
+        bool solve_helper(int from);
+
+        uint8_t cells[CELLS]; // 0 for empty, otherwise the digit
+        Mask rows[SIZE];
+        Mask columns[SIZE];
+        Mask boxes[SIZE];
+};
+
+using Grid = BasicGrid<3>;
+
+#endif
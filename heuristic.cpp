@@ -0,0 +1,236 @@
+#ifndef HEURISTIC_CPP
+#define HEURISTIC_CPP
+#include "heuristic.hpp"
+#include "budget.hpp"
+#include "propagate.hpp"
+
+/// @brief Maps a heuristic name from the command line to the heuristic.
+/// @param name "first", "mrv", "degree" or "lcv".
+/// @param heuristic Receives the heuristic.
+/// @return True if the name is known.
+bool parse_heuristic(const string& name, Heuristic& heuristic){
+    if(name == "first"){
+        heuristic = Heuristic::first;
+    }
+    else if(name == "mrv"){
+        heuristic = Heuristic::mrv;
+    }
+    else if(name == "degree"){
+        heuristic = Heuristic::degree;
+    }
+    else if(name == "lcv"){
+        heuristic = Heuristic::lcv;
+    }
+    else{
+        return false;
+    }
+    return true;
+}
+
+/// @brief Returns the name parse_heuristic accepts for a heuristic.
+const char* heuristic_name(Heuristic heuristic){
+    switch(heuristic){
+        case Heuristic::first: return "first";
+        case Heuristic::mrv: return "mrv";
+        case Heuristic::degree: return "degree";
+        case Heuristic::lcv: return "lcv";
+    }
+    return "unknown";
+}
+
+/// @brief Propagates the grid on 9x9, then searches.
+/// @param grid The partial grid, must have consistent givens. Receives the solution.
+/// @return True if a solution was found, otherwise false and the grid is left as it was.
+template<int Box>
+bool BranchSearch<Box>::solve(BasicGrid<Box>& grid){
+
+    if constexpr(Box == 3){
+        if(propagator.run(grid) && propagated_search(grid)){
+            return true;
+        }
+
+        // Take the propagated digits back out, the guesses are rolled back already.
+        for(int i = propagator.placed() - 1; i >= 0; i--){
+            grid.unplace(propagator.placed_cell(i));
+        }
+        return false;
+    }
+    else{
+        return search(grid);
+    }
+}
+
+/// @brief Recursive backtracking on the boards other than 9x9. Forced digits go first, as in BasicGrid::best_branch:
+///         a cell or a unit digit with a single choice left is filled without asking the heuristic, and a unit digit
+///         with no place left ends the branch. Only real choices follow the cell and digit order of the heuristic.
+///         Every placement is undone on the way back unless a solution was found.
+/// @return True if the remaining cells were solved, otherwise false.
+template<int Box>
+bool BranchSearch<Box>::search(BasicGrid<Box>& grid){
+
+    STAT_ADD(nodes, 1);
+    STAT_DEPTH();
+
+    if(!budget_node()){
+        return false;
+    }
+
+    int cell;
+    Mask choices;
+    if(!grid.best_branch(cell, choices)){
+        return false;
+    }
+    if(cell == -1){
+        return true; // Puzzle is solved when there are no more empty cells.
+    }
+
+    uint8_t digits[Traits::SIZE];
+    int count = 1;
+    if((choices & (choices - 1)) == 0){
+        digits[0] = __builtin_ctz(choices) + 1;
+    }
+    else{
+        cell = pick(grid, cell);
+        count = order(grid, cell, digits);
+    }
+
+    for(int i = 0; i < count; i++){
+        grid.place(cell, digits[i]);
+        STAT_ADD(candidates_tried, 1);
+
+        if(search(grid)){
+            return true;
+        }
+        grid.unplace(cell);
+        STAT_ADD(backtracks, 1);
+    }
+    return false;
+}
+
+/// @brief Recursive backtracking on 9x9: every digit of the heuristic's cell, in its order, is assumed and propagated,
+///         and rolled back if the search below it fails.
+/// @return True if the remaining cells were solved, otherwise false with the grid and propagator as they were.
+template<int Box>
+bool BranchSearch<Box>::propagated_search(BasicGrid<Box>& grid){
+
+    STAT_ADD(nodes, 1);
+    STAT_DEPTH();
+
+    if(!budget_node()){
+        return false;
+    }
+
+    int cell = propagator.best_cell();
+    if(cell == -1){
+        return true; // Puzzle is solved when there are no more empty cells.
+    }
+
+    uint8_t digits[Traits::SIZE];
+    cell = pick(grid, cell);
+    int count = order(grid, cell, digits);
+
+    Propagator::Checkpoint checkpoint;
+    propagator.checkpoint(checkpoint);
+    for(int i = 0; i < count; i++){
+        STAT_ADD(candidates_tried, 1);
+
+        if(propagator.assume(grid, cell, digits[i]) && propagated_search(grid)){
+            return true;
+        }
+        propagator.rollback(grid, checkpoint);
+        STAT_ADD(backtracks, 1);
+    }
+    return false;
+}
+
+/// @brief Picks the branch cell among the empty cells with the fewest candidates: the first one in row-major order for
+///         mrv, the one with the most empty peers for degree and lcv. The empty peers are only counted for the cells
+///         that tie.
+/// @param fewest The first empty cell with the fewest candidates.
+/// @return The cell.
+template<int Box>
+int BranchSearch<Box>::pick(const BasicGrid<Box>& grid, int fewest) const{
+
+    if(heuristic == Heuristic::mrv){
+        return fewest;
+    }
+
+    int best = fewest;
+    int best_count = __builtin_popcount(candidates(grid, fewest));
+    int best_degree = -1;
+
+    for(int cell = fewest; cell < Traits::CELLS; cell++){
+        if(grid.get(cell) != 0 || __builtin_popcount(candidates(grid, cell)) != best_count){
+            continue;
+        }
+        int empty = 0;
+        for(int peer : UNIT_TABLE<Box>.peers[cell]){
+            empty += grid.get(peer) == 0;
+        }
+        if(empty > best_degree){
+            best = cell;
+            best_degree = empty;
+        }
+    }
+    return best;
+}
+
+/// @brief Returns the candidates of a cell: the propagated ones on 9x9, the grid's on the other sizes.
+template<int Box>
+typename BranchSearch<Box>::Mask BranchSearch<Box>::candidates(const BasicGrid<Box>& grid, int cell) const{
+    if constexpr(Box == 3){
+        return propagator.candidates(cell);
+    }
+    else{
+        return grid.candidates(cell);
+    }
+}
+
+/// @brief Lists the candidates of a cell in the order they are tried: lowest digit first, or for lcv the digit that
+///         removes the fewest candidates from the empty peers first, ties to the lower digit.
+/// @param digits Receives the digits, at least SIZE entries.
+/// @return The number of digits.
+template<int Box>
+int BranchSearch<Box>::order(const BasicGrid<Box>& grid, int cell, uint8_t digits[]) const{
+
+    int count = 0;
+    int cost[Traits::SIZE];
+
+    for(Mask mask = candidates(grid, cell); mask != 0; mask &= mask - 1){
+        int val = __builtin_ctz(mask) + 1;
+        int constrained = 0;
+
+        if(heuristic == Heuristic::lcv){
+            for(int peer : UNIT_TABLE<Box>.peers[cell]){
+                constrained += grid.get(peer) == 0 && (candidates(grid, peer) & (mask & -mask));
+            }
+        }
+
+        // Insertion sort on the cost, stable so equal costs keep the digit order.
+        int i = count++;
+        for(; i > 0 && cost[i - 1] > constrained; i--){
+            cost[i] = cost[i - 1];
+            digits[i] = digits[i - 1];
+        }
+        cost[i] = constrained;
+        digits[i] = val;
+    }
+    return count;
+}
+
+/// @brief Solves a grid with a branching heuristic. Heuristic::first is the grid's own solve, the others BranchSearch.
+/// @param grid The puzzle, must have consistent givens. Receives the solution.
+/// @param heuristic The branching heuristic.
+/// @return True if a solution was found, otherwise false and the grid is left as it was.
+template<int Box>
+bool solve_heuristic(BasicGrid<Box>& grid, Heuristic heuristic){
+
+    if(heuristic == Heuristic::first){
+        return grid.solve();
+    }
+
+    BranchSearch<Box> search(heuristic);
+    return search.solve(grid);
+}
+
+#endif
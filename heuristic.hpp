@@ -0,0 +1,49 @@
+#ifndef HEURISTIC_H
+#define HEURISTIC_H
+#include "grid.hpp"
+#include "propagate.hpp"
+#include <string>
+
+using namespace std;
+
+/// @brief Branching heuristics of the backtracking engine, picked per run.
+enum class Heuristic{
+    first, // The grid's own order: first empty cell and digits in order on 9x9, BasicGrid::best_branch on the others
+    mrv, // Cell with the fewest remaining candidates, digits in order
+    degree, // As mrv, ties broken by the most empty peers
+    lcv // Cell as degree, digits ordered least-constraining first
+};
+
+bool parse_heuristic(const string& name, Heuristic& heuristic); // Maps a command line name, false if unknown
+const char* heuristic_name(Heuristic heuristic); // Name of the heuristic as accepted by parse_heuristic
+
+/// @brief Backtracking search that branches where a heuristic says. Forced moves come first and are the same for
+///         every heuristic: on 9x9 every guess is propagated like in count_solutions (see Propagator::assume), on the
+///         other sizes a cell or unit digit with one choice left is filled as in BasicGrid::best_branch. The heuristic
+///         only orders the real choices, so it never searches cells the grid's own solve would have forced.
+template<int Box>
+class BranchSearch{
+    public:
+
+        using Traits = BoardTraits<Box>;
+        using Mask = typename Traits::Mask;
+
+        explicit BranchSearch(Heuristic heuristic) : heuristic(heuristic) {}
+
+        bool solve(BasicGrid<Box>& grid); // Searches from the current grid, false and the grid unchanged on failure
+
+    private:
+        bool search(BasicGrid<Box>& grid);
+        bool propagated_search(BasicGrid<Box>& grid); // The search on 9x9
+        int pick(const BasicGrid<Box>& grid, int fewest) const; // Branch cell among those with fewest candidates
+        int order(const BasicGrid<Box>& grid, int cell, uint8_t digits[]) const; // Digits to try, returns how many
+        Mask candidates(const BasicGrid<Box>& grid, int cell) const; // Propagated candidates on 9x9
+
+        Heuristic heuristic;
+        Propagator propagator; // Candidates of the 9x9 search
+};
+
+template<int Box>
+bool solve_heuristic(BasicGrid<Box>& grid, Heuristic heuristic); // Solves in place with the chosen heuristic
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef IO_CPP
+#define IO_CPP
+#include "io.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/// @brief Destructor for the MappedFile class, unmaps the file.
+MappedFile::~MappedFile(){
+    close();
+}
+
+/// @brief Maps a file read-only and tells the kernel it will be read sequentially.
+/// @param path The file to map.
+/// @return True on success. An empty file succeeds with size 0.
+bool MappedFile::open(const string& path){
+
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0){
+        return false;
+    }
+
+    struct stat info;
+    if(fstat(fd, &info) != 0){
+        ::close(fd);
+        return false;
+    }
+
+    length = info.st_size;
+    if(length > 0){
+        void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(address == MAP_FAILED){
+            ::close(fd);
+            length = 0;
+            return false;
+        }
+        madvise(address, length, MADV_SEQUENTIAL);
+        begin = (const char*)address;
+        mapped = true;
+    }
+
+    ::close(fd); // The mapping stays valid after the descriptor is closed.
+    return true;
+}
+
+/// @brief Unmaps the file, if one is mapped.
+void MappedFile::close(){
+    if(mapped){
+        munmap((void*)begin, length);
+    }
+    begin = nullptr;
+    length = 0;
+    mapped = false;
+}
+
+/// @brief Returns the start of the next puzzle line. Shorter lines and '#' comment lines are skipped.
+/// @return A pointer to at least width readable characters, or nullptr when the block is done.
+const char* LineScanner::next(){
+
+    while(position < end){
+        const char* line = position;
+        const char* newline = (const char*)memchr(line, '\n', end - line);
+        const char* line_end = newline ? newline : end;
+
+        position = newline ? newline + 1 : end;
+        if((size_t)(line_end - line) >= width && line[0] != '#'){
+            return line;
+        }
+    }
+    return nullptr;
+}
+
+/// @brief Constructor for the BufferedWriter class.
+/// @param capacity The buffer size, writes are handed to the kernel in blocks of about this size.
+BufferedWriter::BufferedWriter(size_t capacity) : buffer(capacity){
+}
+
+/// @brief Destructor for the BufferedWriter class, flushes and closes the file.
+BufferedWriter::~BufferedWriter(){
+    close();
+}
+
+/// @brief Opens the output.
+/// @param path The file to create or truncate, empty for standard output.
+/// @return False if the file cannot be opened.
+bool BufferedWriter::open(const string& path){
+
+    close();
+    failed = false;
+
+    if(path.empty()){
+        fd = STDOUT_FILENO;
+        owns_fd = false;
+        return true;
+    }
+
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    owns_fd = fd >= 0;
+    return fd >= 0;
+}
+
+/// @brief Appends to the buffer, blocks larger than the buffer skip it and go straight to the file.
+void BufferedWriter::write(const char* text, size_t count){
+
+    if(used + count > buffer.size()){
+        flush();
+        if(count >= buffer.size()){
+            failed |= !write_all(text, count);
+            return;
+        }
+    }
+    memcpy(buffer.data() + used, text, count);
+    used += count;
+}
+
+/// @brief Writes out whatever is buffered.
+/// @return False if any write so far has failed.
+bool BufferedWriter::flush(){
+    if(used > 0 && fd >= 0){
+        failed |= !write_all(buffer.data(), used);
+    }
+    used = 0;
+    return !failed;
+}
+
+/// @brief Flushes and closes the file. Standard output is flushed but left open.
+/// @return False if any write has failed.
+bool BufferedWriter::close(){
+
+    bool ok = flush();
+    if(owns_fd){
+        ok &= ::close(fd) == 0;
+    }
+    fd = -1;
+    owns_fd = false;
+    return ok;
+}
+
+/// @brief Loops over partial writes and interrupted calls.
+bool BufferedWriter::write_all(const char* text, size_t count){
+    while(count > 0){
+        ssize_t written = ::write(fd, text, count);
+        if(written < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return false;
+        }
+        text += written;
+        count -= written;
+    }
+    return true;
+}
+
+#endif
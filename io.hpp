@@ -0,0 +1,71 @@
+#ifndef IO_H
+#define IO_H
+#include <cstddef>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/// @brief Read-only memory mapping of a whole file. Puzzles are parsed straight out of the mapping, so reading a
+///         multi-gigabyte file costs no copies and no per-puzzle allocation; the kernel pages it in as the scan goes.
+class MappedFile{
+    public:
+
+        MappedFile() = default;
+        ~MappedFile(); // Unmaps the file
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool open(const string& path); // Maps a file, false if it cannot be opened or mapped
+        void close();
+
+        const char* data() const { return begin; }
+        size_t size() const { return length; }
+
+    private:
+        const char* begin = nullptr;
+        size_t length = 0;
+        bool mapped = false;
+};
+
+/// @brief Scans a memory block for puzzle lines: lines of at least width characters (81 for 9x9) that do not start
+///         with '#'.
+class LineScanner{
+    public:
+
+        LineScanner(const char* data, size_t size, size_t width = 81) : position(data), end(data + size), width(width) {}
+
+        const char* next(); // Start of the next puzzle line, nullptr at the end
+
+    private:
+        const char* position;
+        const char* end;
+        size_t width;
+};
+
+/// @brief Output through one large buffer and plain write calls, never flushed per line.
+class BufferedWriter{
+    public:
+
+        explicit BufferedWriter(size_t capacity = 1 << 20);
+        ~BufferedWriter(); // Flushes and closes the file
+        BufferedWriter(const BufferedWriter&) = delete;
+        BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+        bool open(const string& path); // Opens (truncates) a file, an empty path writes to standard output
+        void write(const char* text, size_t count);
+        void write(const string& text) { write(text.data(), text.size()); }
+        bool flush(); // Writes the buffer out, false on a write error
+        bool close();
+
+    private:
+        bool write_all(const char* text, size_t count);
+
+        int fd = -1;
+        bool owns_fd = false;
+        bool failed = false;
+        vector<char> buffer;
+        size_t used = 0;
+};
+
+#endif
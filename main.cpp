@@ -1,7 +1,37 @@
+#include "stats.cpp"
+#include "grid.cpp"
+#include "propagate.cpp"
+#include "count.cpp"
+#include "heuristic.cpp"
+#include "dlx.cpp"
+#include "sliced.cpp"
+#include "engine.cpp"
+#include "canon.cpp"
+#include "cache.cpp"
+#include "thread_pool.cpp"
+#include "parallel.cpp"
+#include "io.cpp"
+#include "pack.cpp"
+#include "validate.cpp"
+#include "batch.cpp"
+#include "grade.cpp"
+#include "generator.cpp"
+#include "budget.cpp"
+#include "portfolio.cpp"
+#include "session.cpp"
+#include "enumerate.cpp"
+#include "variant.cpp"
+#include "server.cpp"
+#include "cli.cpp"
 #include "sudoku.cpp"
 
-int main() {
+int main(int argc, char* argv[]) {
+
+    // Any argument selects the non-interactive command line modes
+    if(argc > 1){
+        return run_cli(argc, argv);
+    }
 
     Sudoku solver;
     
-}
\ No newline at end of file
+}
@@ -0,0 +1,318 @@
+#ifndef PACK_CPP
+#define PACK_CPP
+#include "pack.hpp"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+static const char PACK_MAGIC[8] = {'S', 'U', 'D', 'O', 'K', 'U', 'P', 'K'};
+static const uint32_t PACK_VERSION = 1;
+static const uint32_t PACK_FLAG_SOLUTIONS = 1;
+
+/// @brief Stores an integer in little endian order.
+static void put_le(uint8_t* bytes, uint64_t value, int size){
+    for(int i = 0; i < size; i++){
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/// @brief Loads a little endian integer.
+static uint64_t get_le(const uint8_t* bytes, int size){
+    uint64_t value = 0;
+    for(int i = 0; i < size; i++){
+        value |= (uint64_t)bytes[i] << (8 * i);
+    }
+    return value;
+}
+
+/// @brief Packs a board at 4 bits per cell, cell 2i in the low nibble of byte i and cell 2i + 1 in the high nibble.
+/// @param grid The board.
+/// @param bytes Receives PACKED_BOARD bytes.
+void pack_board(const Grid& grid, uint8_t* bytes){
+    for(int i = 0; i < 40; i++){
+        bytes[i] = grid.get(2 * i) | (grid.get(2 * i + 1) << 4);
+    }
+    bytes[40] = grid.get(80);
+}
+
+/// @brief Unpacks a board written by pack_board.
+/// @param bytes PACKED_BOARD bytes.
+/// @param grid Receives the board.
+/// @return False if a cell is not 0..9 or the digits repeat in a row, column or box.
+bool unpack_board(const uint8_t* bytes, Grid& grid){
+
+    grid = Grid();
+
+    for(int cell = 0; cell < 81; cell++){
+        int val = (cell & 1) ? bytes[cell >> 1] >> 4 : bytes[cell >> 1] & 0xF;
+
+        if(val == 0){
+            continue;
+        }
+        if(val > 9 || !(grid.candidates(cell) & (1 << (val - 1)))){
+            return false;
+        }
+        grid.place(cell, val);
+    }
+    return true;
+}
+
+/// @brief Checks for the container magic.
+bool is_pack(const char* data, size_t size){
+    return size >= sizeof(PACK_MAGIC) && memcmp(data, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0;
+}
+
+/// @brief Reads and checks a container header.
+/// @param data The start of the file.
+/// @param size The file size, the records must all fit in it.
+/// @param header Receives the fields.
+/// @return False if the magic, version or sizes do not match.
+bool read_pack_header(const char* data, size_t size, PackHeader& header){
+
+    const uint8_t* bytes = (const uint8_t*)data;
+
+    if(size < PACK_HEADER || !is_pack(data, size) || get_le(bytes + 8, 4) != PACK_VERSION || get_le(bytes + 28, 4) != 4){
+        return false;
+    }
+
+    header.solutions = get_le(bytes + 12, 4) & PACK_FLAG_SOLUTIONS;
+    header.count = get_le(bytes + 16, 8);
+    header.record_size = get_le(bytes + 24, 4);
+    header.data_offset = get_le(bytes + 32, 8);
+
+    if(header.record_size != PACKED_BOARD * (header.solutions ? 2 : 1) || header.data_offset < PACK_HEADER ||
+       header.data_offset > size || (size - header.data_offset) / header.record_size < header.count){
+        return false;
+    }
+    return true;
+}
+
+/// @brief Writes a container header.
+/// @param header The fields, record_size and data_offset are written as given.
+/// @param bytes Receives PACK_HEADER bytes.
+void write_pack_header(const PackHeader& header, uint8_t* bytes){
+    memset(bytes, 0, PACK_HEADER);
+    memcpy(bytes, PACK_MAGIC, sizeof(PACK_MAGIC));
+    put_le(bytes + 8, PACK_VERSION, 4);
+    put_le(bytes + 12, header.solutions ? PACK_FLAG_SOLUTIONS : 0, 4);
+    put_le(bytes + 16, header.count, 8);
+    put_le(bytes + 24, header.record_size, 4);
+    put_le(bytes + 28, 4, 4);
+    put_le(bytes + 32, header.data_offset, 8);
+}
+
+/// @brief Maps a container and checks its header.
+/// @param path The container file.
+/// @return False if the file cannot be opened or is not a valid container.
+bool PackReader::open(const string& path){
+    if(!File.open(path) || !read_pack_header(File.data(), File.size(), header)){
+        return false;
+    }
+    base = (const uint8_t*)File.data();
+    return true;
+}
+
+
+/*                                              Converters to and from text                                                      */
+
+
+/// @brief Reads boards from text, either one 81-character line per board or the 9x9 layout create_board reads
+///         (81 numbers separated by spaces and line breaks, boards back to back).
+class TextBoards{
+    public:
+
+        TextBoards(const MappedFile& File, bool grid_layout) :
+            lines(File.data(), File.size()), position(File.data()), end(File.data() + File.size()), grid_layout(grid_layout) {}
+
+        /// @brief Reads the next board.
+        /// @return 1 for a board, 0 at the end of the text, -1 for a malformed or inconsistent board.
+        int next(Grid& grid){
+            if(!grid_layout){
+                const char* line = lines.next();
+                return line == nullptr ? 0 : (grid.parse(line) ? 1 : -1);
+            }
+
+            int board[9][9];
+            for(int cell = 0; cell < 81; cell++){
+                while(position < end && isspace((unsigned char)*position)){
+                    position++;
+                }
+                if(position == end){
+                    return cell == 0 ? 0 : -1;
+                }
+                if(!isdigit((unsigned char)*position) || (position + 1 < end && !isspace((unsigned char)position[1]))){
+                    return -1;
+                }
+                board[row_of(cell)][column_of(cell)] = *position++ - '0';
+            }
+            return grid.load(board) ? 1 : -1;
+        }
+
+    private:
+        LineScanner lines;
+        const char* position;
+        const char* end;
+        bool grid_layout;
+};
+
+/// @brief Converts a text file of puzzles, and optionally a matching file of solution lines, into a container.
+///         Exits with an error on a malformed puzzle, a solution that does not match its puzzle, or an I/O error.
+/// @param options The input, solutions and output files and the text layout.
+/// @return The number of records written.
+uint64_t pack_file(const PackOptions& options){
+
+    MappedFile input;
+    MappedFile solutions;
+    BufferedWriter output;
+
+    if(!input.open(options.input)){
+        cerr << "ERROR: Failed to open " << options.input << ", check if file exists and try again." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(!options.solutions.empty() && !solutions.open(options.solutions)){
+        cerr << "ERROR: Failed to open " << options.solutions << ", check if file exists and try again." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(options.output.empty() || !output.open(options.output)){
+        cerr << "ERROR: Failed to open " << (options.output.empty() ? "the output, use --output" : options.output)
+             << " for writing." << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    // The header holds the record count, so count the boards first.
+    PackHeader header;
+    header.solutions = !options.solutions.empty();
+    header.record_size = PACKED_BOARD * (header.solutions ? 2 : 1);
+
+    Grid puzzle;
+    Grid solution;
+    {
+        TextBoards boards(input, options.grid_layout);
+        int status;
+        while((status = boards.next(puzzle)) != 0){
+            if(status < 0){
+                cerr << "ERROR: Puzzle " << header.count + 1 << " in " << options.input << " is malformed or repeats a digit." << endl;
+                exit(EXIT_FAILURE);
+            }
+            header.count++;
+        }
+    }
+
+    uint8_t header_bytes[PACK_HEADER];
+    write_pack_header(header, header_bytes);
+    output.write((const char*)header_bytes, PACK_HEADER);
+
+    uint8_t bytes[2 * PACKED_BOARD];
+
+    TextBoards boards(input, options.grid_layout);
+    LineScanner solution_lines(solutions.data(), solutions.size());
+
+    for(uint64_t k = 0; k < header.count; k++){
+        boards.next(puzzle);
+        pack_board(puzzle, bytes);
+
+        if(header.solutions){
+            const char* line = solution_lines.next();
+            bool matches = line != nullptr && solution.parse(line) && solution.find_empty() == -1;
+            for(int cell = 0; matches && cell < 81; cell++){
+                matches = puzzle.get(cell) == 0 || puzzle.get(cell) == solution.get(cell);
+            }
+            if(!matches){
+                cerr << "ERROR: Solution " << k + 1 << " in " << options.solutions << " is missing, incomplete or does not match its puzzle." << endl;
+                exit(EXIT_FAILURE);
+            }
+            pack_board(solution, bytes + PACKED_BOARD);
+        }
+        output.write((const char*)bytes, header.record_size);
+    }
+
+    if(!output.close()){
+        cerr << "ERROR: Failed to write " << options.output << "." << endl;
+        exit(EXIT_FAILURE);
+    }
+    return header.count;
+}
+
+/// @brief Writes a board in the 9x9 layout of the bundled puzzle files, boxes separated by spaces and blank lines.
+static void write_grid_layout(BufferedWriter& output, const Grid& grid){
+    char text[256];
+    int length = 0;
+
+    for(int row = 0; row < 9; row++){
+        if(row % 3 == 0 && row != 0){
+            text[length++] = '\n';
+        }
+        for(int column = 0; column < 9; column++){
+            if(column != 0){
+                length += sprintf(text + length, column % 3 == 0 ? "   " : " ");
+            }
+            text[length++] = '0' + grid.get(row * 9 + column);
+        }
+        text[length++] = '\n';
+    }
+    text[length++] = '\n';
+    output.write(text, length);
+}
+
+/// @brief Converts a container back to text: one 81-character line per puzzle ('.' for blanks), followed by
+///         ",solution" when the container has solutions, or the 9x9 layout create_board reads (puzzles only).
+/// @param options The container, the output file, the layout and optionally the single record to write.
+/// @return The number of records written.
+uint64_t unpack_file(const PackOptions& options){
+
+    PackReader reader;
+    BufferedWriter output;
+
+    if(!reader.open(options.input)){
+        cerr << "ERROR: Failed to open " << options.input << ", check if it exists and is a packed puzzle file." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(options.has_index && options.index >= reader.count()){
+        cerr << "ERROR: Index " << options.index << " is out of range, the file has " << reader.count() << " puzzles." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(!output.open(options.output)){
+        cerr << "ERROR: Failed to open " << options.output << " for writing." << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    uint64_t first = options.has_index ? options.index : 0;
+    uint64_t last = options.has_index ? options.index + 1 : reader.count();
+    Grid grid;
+    char line[164];
+
+    for(uint64_t k = first; k < last; k++){
+        if(!reader.puzzle(k, grid)){
+            cerr << "ERROR: Record " << k << " of " << options.input << " is corrupt." << endl;
+            exit(EXIT_FAILURE);
+        }
+
+        if(options.grid_layout){
+            write_grid_layout(output, grid);
+            continue;
+        }
+
+        grid.format(line);
+        int length = 81;
+        if(reader.has_solutions()){
+            line[length++] = ',';
+            if(!reader.solution(k, grid)){
+                cerr << "ERROR: Record " << k << " of " << options.input << " is corrupt." << endl;
+                exit(EXIT_FAILURE);
+            }
+            grid.format(line + length);
+            length += 81;
+        }
+        line[length++] = '\n';
+        output.write(line, length);
+    }
+
+    if(!output.close()){
+        cerr << "ERROR: Failed to write the puzzles." << endl;
+        exit(EXIT_FAILURE);
+    }
+    return last - first;
+}
+
+#endif
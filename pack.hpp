@@ -0,0 +1,79 @@
+#ifndef PACK_H
+#define PACK_H
+#include "grid.hpp"
+#include "io.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+/*
+ * Packed puzzle container, all integers little endian.
+ *
+ *   offset  size  field
+ *        0     8  magic "SUDOKUPK"
+ *        8     4  version, 1
+ *       12     4  flags, bit 0 set when every record also holds the solution
+ *       16     8  number of records
+ *       24     4  record size in bytes, 41 or 82
+ *       28     4  bits per cell, 4
+ *       32     8  offset of the first record, 64
+ *       40    24  reserved, zero
+ *
+ * A board is 81 cells of 4 bits (0 for blank, 1..9 for a digit), two cells per byte with the lower cell index in the
+ * low nibble: 41 bytes. Records have a fixed size, so the offset of record k is data offset + k * record size and any
+ * puzzle can be read in O(1) without an offset table.
+ */
+
+static const size_t PACKED_BOARD = 41;
+static const size_t PACK_HEADER = 64;
+
+/// @brief The fields of a container header.
+struct PackHeader{
+    uint64_t count = 0;
+    bool solutions = false;
+    uint32_t record_size = PACKED_BOARD;
+    uint64_t data_offset = PACK_HEADER;
+};
+
+void pack_board(const Grid& grid, uint8_t* bytes); // Writes the 41-byte form of a board
+bool unpack_board(const uint8_t* bytes, Grid& grid); // Reads a 41-byte board, false if a nibble is not 0..9 or digits repeat
+
+bool is_pack(const char* data, size_t size); // True if the data starts with the container magic
+bool read_pack_header(const char* data, size_t size, PackHeader& header); // False if the header is invalid or truncated
+void write_pack_header(const PackHeader& header, uint8_t* bytes); // Writes the 64-byte header
+
+/// @brief Random access to the records of a memory mapped container.
+class PackReader{
+    public:
+
+        bool open(const string& path); // Maps the file and checks the header, false if it is not a valid container
+
+        uint64_t count() const { return header.count; }
+        bool has_solutions() const { return header.solutions; }
+
+        const uint8_t* record(uint64_t k) const { return base + header.data_offset + k * header.record_size; }
+        bool puzzle(uint64_t k, Grid& grid) const { return unpack_board(record(k), grid); }
+        bool solution(uint64_t k, Grid& grid) const { return header.solutions && unpack_board(record(k) + PACKED_BOARD, grid); }
+
+    private:
+        MappedFile File;
+        PackHeader header;
+        const uint8_t* base = nullptr;
+};
+
+/// @brief Settings for the converters between the container and the text formats.
+struct PackOptions{
+    string input; // Puzzles to convert
+    string solutions; // For packing: optional file with one solution line per puzzle line
+    string output; // Converted file, empty for standard output when unpacking
+    bool grid_layout = false; // Text side uses the 9x9 layout create_board reads instead of 81-character lines
+    bool has_index = false; // For unpacking: only write record index
+    uint64_t index = 0;
+};
+
+uint64_t pack_file(const PackOptions& options); // Text to container, returns the number of records written
+uint64_t unpack_file(const PackOptions& options); // Container to text, returns the number of records written
+
+#endif
@@ -0,0 +1,176 @@
+#ifndef PARALLEL_CPP
+#define PARALLEL_CPP
+#include "parallel.hpp"
+#include "propagate.hpp"
+#include <atomic>
+#include <mutex>
+
+static const unsigned SPLIT_TASKS_PER_THREAD = 8; // Lower bound on subtrees per worker, so the hard ones can be stolen
+
+/// @brief State shared by every task of one parallel search. It lives on the stack of the caller, which waits for the
+///         pool before returning.
+template<int Box>
+struct SplitSearch{
+    ThreadPool* pool;
+    int limit; // Solutions wanted: 1 to solve, the count limit to count
+    int split_depth; // Branching levels handed out as tasks, deeper levels are searched inside the task
+    atomic<bool> stop{false}; // Set once limit solutions are found, every task checks it at each node
+    atomic<int> found{0};
+    mutex lock;
+    BasicGrid<Box> solution; // The first solution found, guarded by lock
+};
+
+/// @brief Counts a complete grid as a solution and keeps it if it is the first one.
+/// @return True once limit solutions are found, which stops every task.
+template<int Box>
+static bool record_solution(SplitSearch<Box>& state, const BasicGrid<Box>& grid){
+
+    int found = state.found.fetch_add(1) + 1;
+    if(found == 1){
+        lock_guard<mutex> guard(state.lock);
+        state.solution = grid;
+    }
+    if(found >= state.limit){
+        state.stop.store(true, memory_order_relaxed);
+    }
+    return found >= state.limit;
+}
+
+/// @brief Sequential backtracking below the split levels, branching where BasicGrid::best_branch says. Every
+///         placement is undone on the way back, the solutions are copied out by record_solution.
+/// @return True when the search is over: enough solutions were found, here or in another task.
+template<int Box>
+static bool split_leaf(SplitSearch<Box>& state, BasicGrid<Box>& grid){
+
+    STAT_ADD(nodes, 1);
+    STAT_DEPTH();
+
+    if(state.stop.load(memory_order_relaxed)){
+        return true;
+    }
+
+    int cell;
+    typename BasicGrid<Box>::Mask choices;
+    if(!grid.best_branch(cell, choices)){
+        return false;
+    }
+    if(cell == -1){
+        return record_solution(state, grid);
+    }
+
+    for(typename BasicGrid<Box>::Mask mask = choices; mask != 0; mask &= mask - 1){
+        grid.place(cell, __builtin_ctz(mask) + 1);
+        STAT_ADD(candidates_tried, 1);
+
+        bool done = split_leaf(state, grid);
+        grid.unplace(cell);
+        if(done){
+            return true;
+        }
+        STAT_ADD(backtracks, 1);
+    }
+    return false;
+}
+
+/// @brief One task of the search. Forced cells are filled in place; at a real branch above split_depth every digit
+///         becomes a task of its own on the pool, below it the subtree is searched here. Tasks that start after the
+///         search stopped return at once, so the queued work drains quickly after the first solution.
+/// @param grid The subtree of this task, owned by it.
+/// @param depth Real branches taken above this subtree.
+template<int Box>
+static void split_task(SplitSearch<Box>& state, BasicGrid<Box> grid, int depth){
+
+    while(!state.stop.load(memory_order_relaxed)){
+        int cell;
+        typename BasicGrid<Box>::Mask choices;
+        if(!grid.best_branch(cell, choices)){
+            return;
+        }
+        if(cell == -1){
+            record_solution(state, grid);
+            return;
+        }
+        if(depth >= state.split_depth){
+            split_leaf(state, grid);
+            return;
+        }
+        if((choices & (choices - 1)) == 0){
+            grid.place(cell, __builtin_ctz(choices) + 1);
+            continue;
+        }
+
+        for(typename BasicGrid<Box>::Mask mask = choices; mask != 0; mask &= mask - 1){
+            BasicGrid<Box> child = grid;
+            child.place(cell, __builtin_ctz(mask) + 1);
+            state.pool->submit([&state, child, depth] {
+                split_task(state, child, depth + 1);
+            });
+        }
+        return;
+    }
+}
+
+/// @brief Runs a search of a grid on the pool and waits for it. On 9x9 the constraint propagation fills the forced
+///         cells first, as in BasicGrid::solve.
+/// @return The solutions found, at most state.limit, or 0 if the givens are contradictory.
+template<int Box>
+static int run_split(SplitSearch<Box>& state, const BasicGrid<Box>& grid){
+
+    BasicGrid<Box> root = grid;
+    if constexpr(Box == 3){
+        Propagator propagator;
+        if(!propagator.run(root)){
+            return 0;
+        }
+    }
+
+    // Enough branching levels that even a binary tree gives every worker SPLIT_TASKS_PER_THREAD subtrees.
+    state.split_depth = 0;
+    while((1u << state.split_depth) < state.pool->size() * SPLIT_TASKS_PER_THREAD){
+        state.split_depth++;
+    }
+
+    state.pool->submit([&state, root] {
+        split_task(state, root, 0);
+    });
+    state.pool->wait();
+    return min(state.found.load(), state.limit);
+}
+
+/// @brief Solves one puzzle with every worker of the pool. The top branching levels are split into tasks that the
+///         workers steal from each other; the first solution found cancels the rest. A puzzle with several solutions
+///         may get any one of them.
+/// @param grid The puzzle, must have consistent givens. Receives the solution.
+/// @param pool The pool, only used by this search until it returns.
+/// @return True if a solution was found, otherwise false and the grid is left as it was.
+template<int Box>
+bool solve_parallel(BasicGrid<Box>& grid, ThreadPool& pool){
+
+    SplitSearch<Box> state;
+    state.pool = &pool;
+    state.limit = 1;
+
+    if(run_split(state, grid) == 0){
+        return false;
+    }
+    grid = state.solution;
+    return true;
+}
+
+/// @brief Counts the solutions of a grid with every worker of the pool, with early exit: the workers add to one shared
+///         count and all of them stop once it reaches limit. With a limit of 2 this is the uniqueness test.
+/// @param grid The puzzle, it is not changed.
+/// @param limit The search stops as soon as this many solutions are found.
+/// @param pool The pool, only used by this search until it returns.
+/// @return The number of solutions, at most limit. 0 if the givens repeat a digit.
+template<int Box>
+int count_parallel(const BasicGrid<Box>& grid, int limit, ThreadPool& pool){
+
+    SplitSearch<Box> state;
+    state.pool = &pool;
+    state.limit = limit;
+
+    return limit > 0 ? run_split(state, grid) : 0;
+}
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+#include "grid.hpp"
+#include "thread_pool.hpp"
+
+using namespace std;
+
+// Searches of a single puzzle spread over every worker of a pool. Both must be called from outside the pool, they
+// wait for it to run dry.
+
+template<int Box>
+bool solve_parallel(BasicGrid<Box>& grid, ThreadPool& pool); // Solves in place, the first solution found wins
+template<int Box>
+int count_parallel(const BasicGrid<Box>& grid, int limit, ThreadPool& pool); // Solutions up to limit, over all workers
+
+#endif
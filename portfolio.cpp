@@ -0,0 +1,159 @@
+#ifndef PORTFOLIO_CPP
+#define PORTFOLIO_CPP
+#include "portfolio.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/// @brief Reads a comma-separated list of strategies, each an engine name with an optional ':' and heuristic name.
+/// @param list The list, for example "backtrack:first,backtrack:mrv,dlx".
+/// @param strategies Receives the strategies, in the order of the list.
+/// @return False if the list is empty or names an unknown engine or heuristic.
+bool parse_portfolio(const string& list, vector<Strategy>& strategies){
+
+    strategies.clear();
+    size_t start = 0;
+    while(start <= list.size()){
+        size_t end = min(list.find(',', start), list.size());
+        string token = list.substr(start, end - start);
+        size_t colon = token.find(':');
+
+        Strategy strategy;
+        if(!parse_engine(token.substr(0, colon), strategy.engine) ||
+           (colon != string::npos && !parse_heuristic(token.substr(colon + 1), strategy.heuristic))){
+            return false;
+        }
+        strategies.push_back(strategy);
+        start = end + 1;
+    }
+    return !strategies.empty();
+}
+
+/// @brief Returns the name parse_portfolio reads for a strategy, the heuristic only for the backtrack engine.
+string strategy_name(const Strategy& strategy){
+    string name = engine_name(strategy.engine);
+    if(strategy.engine == Engine::backtrack){
+        name += string(":") + heuristic_name(strategy.heuristic);
+    }
+    return name;
+}
+
+/// @brief Tells if a bounded call ran to its end, with a solution or with a proof there is none.
+static bool finished(Outcome outcome){
+    return outcome == Outcome::solved || outcome == Outcome::unsolvable;
+}
+
+/// @brief Solves a puzzle with every strategy at once, each on a thread of its own, and keeps the first to finish.
+///         The main thread waits for them and passes a cancellation of the budget's token on to the racers.
+/// @param puzzle The puzzle, must have consistent givens.
+/// @param strategies The strategies to race, at least one.
+/// @param budget The limits: the node limit per strategy, the deadline and the token for the whole race.
+/// @return The winner's result, or exhausted/cancelled (the reason of the first strategy) if none finished.
+PortfolioResult race_portfolio(const Grid& puzzle, const vector<Strategy>& strategies, const Budget& budget){
+
+    auto stop = make_shared<CancelToken>();
+    Budget racer = budget;
+    racer.cancel = stop;
+    if(budget.cancel && budget.cancel->cancelled()){
+        stop->cancel();
+    }
+
+    mutex lock;
+    condition_variable done;
+    vector<BoundedResult<3>> results(strategies.size());
+    size_t running = strategies.size();
+    int winner = -1;
+
+    vector<thread> threads;
+    for(size_t i = 0; i < strategies.size(); i++){
+        threads.emplace_back([&, i] {
+            BoundedResult<3> result = solve_bounded(puzzle, racer, strategies[i].engine, strategies[i].heuristic);
+
+            lock_guard<mutex> guard(lock);
+            results[i] = result;
+            if(winner == -1 && finished(result.outcome)){
+                winner = i;
+                stop->cancel();
+            }
+            running--;
+            done.notify_one();
+        });
+    }
+
+    // The racers only read their own token, so a cancelled budget token is polled here and forwarded.
+    {
+        unique_lock<mutex> guard(lock);
+        while(running > 0){
+            done.wait_for(guard, chrono::milliseconds(1));
+            if(budget.cancel && budget.cancel->cancelled()){
+                stop->cancel();
+            }
+        }
+    }
+    for(thread& racer_thread : threads){
+        racer_thread.join();
+    }
+
+    PortfolioResult portfolio;
+    for(const BoundedResult<3>& result : results){
+        portfolio.nodes += result.nodes;
+    }
+    portfolio.winner = winner;
+    portfolio.result = results[winner >= 0 ? winner : 0];
+    if(winner < 0 && budget.cancel && budget.cancel->cancelled()){
+        portfolio.result.outcome = Outcome::cancelled;
+    }
+    else if(winner < 0){
+        portfolio.result.outcome = Outcome::exhausted; // The racers saw the shared deadline or their node limit
+    }
+    return portfolio;
+}
+
+/// @brief Solves a puzzle by giving the strategies turns on the calling thread: in round r every strategy searches the
+///         puzzle from the start with a budget of slice * 2^r nodes, until one finishes or the budget runs out.
+/// @param puzzle The puzzle, must have consistent givens.
+/// @param strategies The strategies, in the order they take their turns, at least one.
+/// @param budget The limits of the whole call, over every round and strategy.
+/// @param slice The nodes of every turn of the first round.
+/// @return The winner's result with its own nodes and time, or exhausted/cancelled with the puzzle if none finished.
+PortfolioResult staged_portfolio(const Grid& puzzle, const vector<Strategy>& strategies, const Budget& budget,
+                                 uint64_t slice){
+
+    auto start = chrono::steady_clock::now();
+    PortfolioResult portfolio;
+    portfolio.result.grid = puzzle;
+    portfolio.result.outcome = Outcome::exhausted;
+
+    for(uint64_t turn = max<uint64_t>(slice, 1);; turn = turn > UINT64_MAX / 2 ? UINT64_MAX : turn * 2){
+        portfolio.rounds++;
+
+        for(size_t i = 0; i < strategies.size(); i++){
+            Budget part = budget;
+            part.nodes = turn;
+            if(budget.nodes > 0){
+                if(portfolio.nodes >= budget.nodes){
+                    return portfolio;
+                }
+                part.nodes = min(turn, budget.nodes - portfolio.nodes);
+            }
+            if(budget.seconds > 0){
+                part.seconds = budget.seconds - chrono::duration<double>(chrono::steady_clock::now() - start).count();
+                if(part.seconds <= 0){
+                    return portfolio;
+                }
+            }
+
+            BoundedResult<3> result = solve_bounded(puzzle, part, strategies[i].engine, strategies[i].heuristic);
+            portfolio.nodes += result.nodes;
+
+            if(finished(result.outcome) || result.outcome == Outcome::cancelled){
+                portfolio.result = result;
+                portfolio.winner = finished(result.outcome) ? (int)i : -1;
+                return portfolio;
+            }
+        }
+    }
+}
+
+#endif
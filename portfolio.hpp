@@ -0,0 +1,41 @@
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "budget.hpp"
+#include "engine.hpp"
+#include "grid.hpp"
+#include "heuristic.hpp"
+
+using namespace std;
+
+/// @brief One entry of a portfolio: an engine and, for the backtrack engine, its branching heuristic.
+struct Strategy{
+    Engine engine = Engine::backtrack;
+    Heuristic heuristic = Heuristic::first;
+};
+
+bool parse_portfolio(const string& list, vector<Strategy>& strategies); // "backtrack:first,backtrack:mrv,dlx", false if bad
+string strategy_name(const Strategy& strategy); // "dlx" or "backtrack:mrv", as parse_portfolio reads it
+
+/// @brief Result of a portfolio call: the result of the strategy that finished first, and what the call cost in total.
+struct PortfolioResult{
+    BoundedResult<3> result; // Outcome and grid of the winner; exhausted/cancelled with the puzzle if none finished
+    int winner = -1; // Index of the strategy that finished, -1 if none did
+    uint64_t nodes = 0; // Search nodes of every strategy together
+    int rounds = 0; // Node slices handed out by the staged portfolio, 0 for a race
+};
+
+// A race runs every strategy at once on a thread of its own. The first one to finish, with a solution or a proof that
+// there is none, cancels the others, so the call takes as long as the fastest strategy on this puzzle plus one clock
+// check. The node limit of the budget applies to every strategy on its own, the deadline and the token to all.
+PortfolioResult race_portfolio(const Grid& puzzle, const vector<Strategy>& strategies, const Budget& budget);
+
+// The staged portfolio runs on the calling thread instead, for batches where every core already has puzzles of its
+// own: the strategies take turns with a node slice each, restarting from the puzzle, and the slice doubles every round.
+// A puzzle that one strategy solves in n nodes costs at most about 2 * n * strategies nodes, whichever it is.
+PortfolioResult staged_portfolio(const Grid& puzzle, const vector<Strategy>& strategies, const Budget& budget,
+                                 uint64_t slice);
+
+#endif
@@ -0,0 +1,512 @@
+#ifndef PROPAGATE_CPP
+#define PROPAGATE_CPP
+#include "propagate.hpp"
+#include <immintrin.h>
+#include <cstring>
+
+/*                                                 Vector kernels                                                                */
+
+// A kernel provides the two hot loops of the propagator:
+//  - singles: bitsets of the lanes holding exactly one candidate and of the lanes holding none.
+//  - tally: for rows first..first + count - 1, which digits appear at least once and at least twice in each of the
+//    9 columns. Over all rows that gives the column units, over one band of 3 rows the box units are three columns each.
+struct PropagationKernel{
+    const char* name;
+    void (*singles)(const uint16_t* lanes, uint64_t single[2], uint64_t empty[2]);
+    void (*tally)(const uint16_t* lanes, int first, int count, uint16_t once[9], uint16_t twice[9]);
+};
+
+/// @brief Sets bit lane of a two-word bitset.
+static inline void set_lane(uint64_t bits[2], int lane){
+    bits[lane >> 6] |= uint64_t(1) << (lane & 63);
+}
+
+static void singles_scalar(const uint16_t* lanes, uint64_t single[2], uint64_t empty[2]){
+    single[0] = single[1] = empty[0] = empty[1] = 0;
+
+    for(int lane = 0; lane < 81; lane++){
+        uint16_t x = lanes[lane];
+        if(x == 0){
+            set_lane(empty, lane);
+        }
+        else if((x & (x - 1)) == 0){
+            set_lane(single, lane);
+        }
+    }
+}
+
+static void tally_scalar(const uint16_t* lanes, int first, int count, uint16_t once[9], uint16_t twice[9]){
+    for(int column = 0; column < 9; column++){
+        uint16_t seen = 0;
+        uint16_t again = 0;
+
+        for(int row = first; row < first + count; row++){
+            uint16_t x = lanes[row * 9 + column] & Grid::ALL;
+            again |= seen & x;
+            seen |= x;
+        }
+        once[column] = seen;
+        twice[column] = again;
+    }
+}
+
+/// @brief Packs the even bits of a byte movemask (one pair of bits per 16-bit lane) into one bit per lane.
+static inline uint32_t lane_bits(uint32_t mask){
+    mask &= 0x55555555;
+    mask = (mask | (mask >> 1)) & 0x33333333;
+    mask = (mask | (mask >> 2)) & 0x0F0F0F0F;
+    mask = (mask | (mask >> 4)) & 0x00FF00FF;
+    mask = (mask | (mask >> 8)) & 0x0000FFFF;
+    return mask;
+}
+
+__attribute__((target("sse4.1")))
+static void singles_sse4(const uint16_t* lanes, uint64_t single[2], uint64_t empty[2]){
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16(1);
+
+    single[0] = single[1] = empty[0] = empty[1] = 0;
+
+    for(int block = 0; block < Propagator::LANES / 8; block++){
+        __m128i x = _mm_load_si128((const __m128i*)(lanes + block * 8));
+        __m128i is_empty = _mm_cmpeq_epi16(x, zero);
+        __m128i one_bit = _mm_cmpeq_epi16(_mm_and_si128(x, _mm_sub_epi16(x, one)), zero);
+
+        uint64_t s = lane_bits(_mm_movemask_epi8(_mm_andnot_si128(is_empty, one_bit)));
+        uint64_t e = lane_bits(_mm_movemask_epi8(is_empty));
+        int shift = (block * 8) & 63;
+        single[block >> 3] |= s << shift;
+        empty[block >> 3] |= e << shift;
+    }
+}
+
+__attribute__((target("sse4.1")))
+static void tally_sse4(const uint16_t* lanes, int first, int count, uint16_t once[9], uint16_t twice[9]){
+    const __m128i digits = _mm_set1_epi16(Grid::ALL);
+    __m128i seen = _mm_setzero_si128();
+    __m128i again = _mm_setzero_si128();
+    uint16_t seen_last = 0;
+    uint16_t again_last = 0;
+
+    for(int row = first; row < first + count; row++){
+        __m128i x = _mm_and_si128(_mm_loadu_si128((const __m128i*)(lanes + row * 9)), digits);
+        again = _mm_or_si128(again, _mm_and_si128(seen, x));
+        seen = _mm_or_si128(seen, x);
+
+        // The ninth column does not fit in 8 lanes.
+        uint16_t last = lanes[row * 9 + 8] & Grid::ALL;
+        again_last |= seen_last & last;
+        seen_last |= last;
+    }
+
+    alignas(16) uint16_t s[8];
+    alignas(16) uint16_t a[8];
+    _mm_store_si128((__m128i*)s, seen);
+    _mm_store_si128((__m128i*)a, again);
+    for(int column = 0; column < 8; column++){
+        once[column] = s[column];
+        twice[column] = a[column];
+    }
+    once[8] = seen_last;
+    twice[8] = again_last;
+}
+
+__attribute__((target("avx2")))
+static void singles_avx2(const uint16_t* lanes, uint64_t single[2], uint64_t empty[2]){
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi16(1);
+
+    single[0] = single[1] = empty[0] = empty[1] = 0;
+
+    for(int block = 0; block < Propagator::LANES / 16; block++){
+        __m256i x = _mm256_load_si256((const __m256i*)(lanes + block * 16));
+        __m256i is_empty = _mm256_cmpeq_epi16(x, zero);
+        __m256i one_bit = _mm256_cmpeq_epi16(_mm256_and_si256(x, _mm256_sub_epi16(x, one)), zero);
+
+        uint64_t s = lane_bits(_mm256_movemask_epi8(_mm256_andnot_si256(is_empty, one_bit)));
+        uint64_t e = lane_bits(_mm256_movemask_epi8(is_empty));
+        int shift = (block * 16) & 63;
+        single[block >> 2] |= s << shift;
+        empty[block >> 2] |= e << shift;
+    }
+}
+
+__attribute__((target("avx2")))
+static void tally_avx2(const uint16_t* lanes, int first, int count, uint16_t once[9], uint16_t twice[9]){
+    const __m256i digits = _mm256_set1_epi16(Grid::ALL);
+    __m256i seen = _mm256_setzero_si256();
+    __m256i again = _mm256_setzero_si256();
+
+    // A row is 9 lanes, a 16-lane load from its first cell covers it; lanes 9..15 spill into the next row and are ignored.
+    for(int row = first; row < first + count; row++){
+        __m256i x = _mm256_and_si256(_mm256_loadu_si256((const __m256i*)(lanes + row * 9)), digits);
+        again = _mm256_or_si256(again, _mm256_and_si256(seen, x));
+        seen = _mm256_or_si256(seen, x);
+    }
+
+    alignas(32) uint16_t s[16];
+    alignas(32) uint16_t a[16];
+    _mm256_store_si256((__m256i*)s, seen);
+    _mm256_store_si256((__m256i*)a, again);
+    for(int column = 0; column < 9; column++){
+        once[column] = s[column];
+        twice[column] = a[column];
+    }
+}
+
+static const PropagationKernel SCALAR_KERNEL = {"scalar", singles_scalar, tally_scalar};
+static const PropagationKernel SSE4_KERNEL = {"sse4.1", singles_sse4, tally_sse4};
+static const PropagationKernel AVX2_KERNEL = {"avx2", singles_avx2, tally_avx2};
+
+/// @brief Picks the widest kernel the CPU supports.
+static const PropagationKernel* detect_kernel(){
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){
+        return &AVX2_KERNEL;
+    }
+    if(__builtin_cpu_supports("sse4.1")){
+        return &SSE4_KERNEL;
+    }
+    return &SCALAR_KERNEL;
+}
+
+static const PropagationKernel* active_kernel = detect_kernel();
+
+/// @brief Returns the name of the kernel in use.
+const char* Propagator::kernel(){
+    return active_kernel->name;
+}
+
+/// @brief Forces a kernel, used to compare them on the same input. Not meant to be called while puzzles are solving.
+/// @param name "avx2", "sse4.1", "scalar", or "auto" for the widest supported one.
+/// @return True if the kernel exists and this CPU supports it.
+bool Propagator::select_kernel(const string& name){
+    if(name == "auto"){
+        active_kernel = detect_kernel();
+    }
+    else if(name == "scalar"){
+        active_kernel = &SCALAR_KERNEL;
+    }
+    else if(name == "sse4.1" && __builtin_cpu_supports("sse4.1")){
+        active_kernel = &SSE4_KERNEL;
+    }
+    else if(name == "avx2" && __builtin_cpu_supports("avx2")){
+        active_kernel = &AVX2_KERNEL;
+    }
+    else{
+        return false;
+    }
+    return true;
+}
+
+
+/*                                                  Propagation                                                                  */
+
+
+/// @brief Runs every deduction until none of them makes progress. Forced digits are placed in the grid and recorded,
+///         so a caller can take them back out with placed/placed_cell.
+/// @param grid The puzzle, must have consistent givens.
+/// @return False if the puzzle has no solution. The digits placed up to that point stay in the grid.
+bool Propagator::run(Grid& grid){
+
+    trail_size = 0;
+
+    for(int cell = 0; cell < 81; cell++){
+        int val = grid.get(cell);
+        lanes[cell] = val ? SOLVED | (1 << (val - 1)) : grid.candidates(cell);
+    }
+    for(int lane = 81; lane < LANES; lane++){
+        lanes[lane] = SOLVED | Grid::ALL; // Never empty, never a single, no digits in a tally.
+    }
+
+    return propagate(grid);
+}
+
+/// @brief Fills a cell with a guessed digit and propagates its consequences. Take a checkpoint first to undo the
+///         guess with rollback, whether it succeeded or not.
+/// @param grid The grid the propagator was run on.
+/// @param cell An unfilled cell.
+/// @param val One of its candidates.
+/// @return False if the guess leads to a contradiction.
+bool Propagator::assume(Grid& grid, int cell, int val){
+    return assign(grid, cell, val) && propagate(grid);
+}
+
+/// @brief Saves the lanes and the length of the trail, to come back to with rollback.
+void Propagator::checkpoint(Checkpoint& to) const{
+    memcpy(to.lanes, lanes, sizeof(lanes));
+    to.placed = trail_size;
+}
+
+/// @brief Takes back everything done since a checkpoint: the cells on the trail past it are cleared in the grid, newest
+///         first, and the lanes are copied back.
+/// @param grid The grid the propagator was run on.
+/// @param to A checkpoint of this propagator, taken since the last run.
+void Propagator::rollback(Grid& grid, const Checkpoint& to){
+    while(trail_size > to.placed){
+        grid.unplace(trail[--trail_size]);
+    }
+    memcpy(lanes, to.lanes, sizeof(lanes));
+}
+
+/// @brief Finds the unfilled cell with the fewest candidates, the first one in row-major order on ties.
+/// @return The cell index, or -1 if every cell is filled.
+int Propagator::best_cell() const{
+
+    int best = -1;
+    int best_count = 10;
+
+    for(int cell = 0; cell < 81; cell++){
+        if(!(lanes[cell] & SOLVED)){
+            int count = __builtin_popcount(lanes[cell]);
+            if(count < best_count){
+                best = cell;
+                best_count = count;
+                if(count <= 2){
+                    break; // Cells with one candidate are filled by propagation, two is the minimum here.
+                }
+            }
+        }
+    }
+    return best;
+}
+
+/// @brief Applies the deductions until none of them makes progress.
+/// @return False if the puzzle has no solution.
+bool Propagator::propagate(Grid& grid){
+
+    bool progress = true;
+    while(progress){
+        progress = false;
+
+        if(!naked_singles(grid, progress)){
+            return false;
+        }
+        if(progress){
+            continue; // Singles are cheap, take them all before the unit scans.
+        }
+        if(!hidden_singles(grid, progress)){
+            return false;
+        }
+        if(progress){
+            continue;
+        }
+        if(!locked_candidates(progress)){
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Fills a cell and removes its digit from the lanes of the 20 peers.
+/// @return False if the digit is no longer a candidate of the cell.
+bool Propagator::assign(Grid& grid, int cell, int val){
+
+    uint16_t bit = 1 << (val - 1);
+
+    if(!(lanes[cell] & bit) || (lanes[cell] & SOLVED)){
+        return false;
+    }
+
+    grid.place(cell, val);
+    trail[trail_size++] = cell;
+    lanes[cell] = SOLVED | bit;
+
+    for(int peer : UNITS.peers[cell]){
+        if(!(lanes[peer] & SOLVED)){
+            STAT_ADD(eliminations, (lanes[peer] & bit) != 0);
+            lanes[peer] &= ~bit;
+        }
+    }
+    return true;
+}
+
+/// @brief Fills every cell that has a single candidate left.
+/// @return False if an empty cell has no candidates.
+bool Propagator::naked_singles(Grid& grid, bool& progress){
+
+    uint64_t single[2];
+    uint64_t empty[2];
+    active_kernel->singles(lanes, single, empty);
+
+    if(empty[0] | (empty[1] & ((uint64_t(1) << 17) - 1))){
+        return false;
+    }
+
+    for(int word = 0; word < 2; word++){
+        for(uint64_t bits = single[word]; bits != 0; bits &= bits - 1){
+            int cell = word * 64 + __builtin_ctzll(bits);
+            if(cell >= 81){
+                break;
+            }
+            // An earlier single in this pass may have taken the digit away, leaving the cell empty.
+            if((lanes[cell] & Grid::ALL) == 0 || !assign(grid, cell, __builtin_ctz(lanes[cell]) + 1)){
+                return false;
+            }
+            progress = true;
+        }
+    }
+    return true;
+}
+
+/// @brief Places the digits of a unit that fit in only one of its cells.
+/// @param cells The 9 cells of the unit.
+/// @param once Digits that appear in at least one cell of the unit.
+/// @param twice Digits that appear in at least two cells of the unit.
+/// @return False if a digit fits nowhere in the unit.
+bool Propagator::hidden_in_unit(Grid& grid, const int* cells, uint16_t once, uint16_t twice, bool& progress){
+
+    if(once != Grid::ALL){
+        return false;
+    }
+
+    for(uint16_t hidden = once & ~twice; hidden != 0; hidden &= hidden - 1){
+        uint16_t bit = hidden & -hidden;
+
+        for(int i = 0; i < 9; i++){
+            int cell = cells[i];
+            if(lanes[cell] & bit){
+                if(!(lanes[cell] & SOLVED)){
+                    if(!assign(grid, cell, __builtin_ctz(bit) + 1)){
+                        return false;
+                    }
+                    progress = true;
+                }
+                break;
+            }
+        }
+    }
+    return true;
+}
+
+/// @brief Hidden singles in every row, column and box. Column and box digit counts come from the vector tally, rows
+///         are horizontal in the lane layout and are counted directly.
+/// @return False if a digit fits nowhere in some unit.
+bool Propagator::hidden_singles(Grid& grid, bool& progress){
+
+    uint16_t once[9];
+    uint16_t twice[9];
+
+    // Columns: tally over all nine rows.
+    active_kernel->tally(lanes, 0, 9, once, twice);
+    for(int column = 0; column < 9; column++){
+        if(!hidden_in_unit(grid, UNITS.cells[9 + column], once[column], twice[column], progress)){
+            return false;
+        }
+    }
+
+    // Boxes: tally over each band of three rows, then merge three columns per box.
+    for(int band = 0; band < 3; band++){
+        active_kernel->tally(lanes, band * 3, 3, once, twice);
+
+        for(int stack = 0; stack < 3; stack++){
+            uint16_t seen = 0;
+            uint16_t again = 0;
+            for(int column = stack * 3; column < stack * 3 + 3; column++){
+                again |= twice[column] | (seen & once[column]);
+                seen |= once[column];
+            }
+            if(!hidden_in_unit(grid, UNITS.cells[18 + band * 3 + stack], seen, again, progress)){
+                return false;
+            }
+        }
+    }
+
+    // Rows.
+    for(int row = 0; row < 9; row++){
+        uint16_t seen = 0;
+        uint16_t again = 0;
+        for(int column = 0; column < 9; column++){
+            uint16_t x = lanes[row * 9 + column] & Grid::ALL;
+            again |= seen & x;
+            seen |= x;
+        }
+        if(!hidden_in_unit(grid, UNITS.cells[row], seen, again, progress)){
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Removes candidates from an unsolved cell.
+/// @return True if something was removed.
+bool Propagator::eliminate(int cell, uint16_t mask){
+    if((lanes[cell] & SOLVED) || !(lanes[cell] & mask)){
+        return false;
+    }
+    STAT_ADD(eliminations, __builtin_popcount(lanes[cell] & mask));
+    lanes[cell] &= ~mask;
+    return true;
+}
+
+/// @brief Locked candidates. A box is cut by each row (and column) into a segment of three cells.
+///         Pointing: a digit that in a box only fits in one segment is removed from the rest of that row or column.
+///         Claiming: a digit that in a row or column only fits in one segment is removed from the rest of that box.
+///         Contradictions show up as empty lanes in the next naked single pass.
+/// @return Always true, the return value keeps the deduction steps uniform.
+bool Propagator::locked_candidates(bool& progress){
+
+    // Candidates of the unsolved cells of every row segment and column segment.
+    uint16_t row_segment[9][3];
+    uint16_t column_segment[9][3];
+
+    for(int line = 0; line < 9; line++){
+        for(int part = 0; part < 3; part++){
+            uint16_t in_row = 0;
+            uint16_t in_column = 0;
+            for(int k = part * 3; k < part * 3 + 3; k++){
+                uint16_t r = lanes[line * 9 + k];
+                uint16_t c = lanes[k * 9 + line];
+                in_row |= (r & SOLVED) ? 0 : r;
+                in_column |= (c & SOLVED) ? 0 : c;
+            }
+            row_segment[line][part] = in_row;
+            column_segment[line][part] = in_column;
+        }
+    }
+
+    for(int line = 0; line < 9; line++){
+        int base = (line / 3) * 3; // First row (or column) of the band (or stack) the line is in
+
+        for(int part = 0; part < 3; part++){
+            uint16_t row_others = row_segment[line][(part + 1) % 3] | row_segment[line][(part + 2) % 3];
+            uint16_t column_others = column_segment[line][(part + 1) % 3] | column_segment[line][(part + 2) % 3];
+
+            uint16_t box_row_others = 0;
+            uint16_t box_column_others = 0;
+            for(int other = base; other < base + 3; other++){
+                if(other != line){
+                    box_row_others |= row_segment[other][part];
+                    box_column_others |= column_segment[other][part];
+                }
+            }
+
+            // Pointing, digits of the box that stay in this row segment.
+            uint16_t pointing = row_segment[line][part] & ~box_row_others;
+            // Claiming, digits of the row that stay in this box.
+            uint16_t claiming = row_segment[line][part] & ~row_others;
+            uint16_t column_pointing = column_segment[line][part] & ~box_column_others;
+            uint16_t column_claiming = column_segment[line][part] & ~column_others;
+
+            for(int k = 0; k < 9; k++){
+                if(k / 3 == part){
+                    continue;
+                }
+                progress |= pointing && eliminate(line * 9 + k, pointing);
+                progress |= column_pointing && eliminate(k * 9 + line, column_pointing);
+            }
+            for(int other = base; other < base + 3; other++){
+                if(other == line){
+                    continue;
+                }
+                for(int k = part * 3; k < part * 3 + 3; k++){
+                    progress |= claiming && eliminate(other * 9 + k, claiming);
+                    progress |= column_claiming && eliminate(k * 9 + other, column_claiming);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef PROPAGATE_H
+#define PROPAGATE_H
+#include "grid.hpp"
+#include <string>
+
+using namespace std;
+
+/// @brief Constraint propagation run before the backtracking search branches.
+///         The 81 candidate sets are kept as 16-bit lanes (padded to 96) so the naked single scan and the column and box
+///         digit counts run 16 cells at a time with AVX2, or 8 at a time with SSE4.1. The kernel is picked at runtime from
+///         what the CPU supports, with a scalar fallback.
+///
+///         Deductions: naked singles, hidden singles, and locked candidates (pointing and claiming). Every deduction holds
+///         in all solutions, so the set of solutions, and therefore the solution the search finds first, is unchanged.
+///
+///         Searches that guess with assume take their guesses back with checkpoint and rollback, on one grid and one
+///         propagator: the placements are popped off the trail and cleared in the grid, and only the 192 bytes of lanes
+///         are saved per guess. A propagation step rewrites a large part of the lanes, so a copy of them costs less
+///         than logging every change.
+class Propagator{
+    public:
+
+        static const uint16_t SOLVED = 0x8000; // Set in the lane of a filled cell, next to its digit bit
+        static const int LANES = 96; // 81 cells padded to a whole number of 256-bit vectors
+
+        /// @brief The candidate lanes and the length of the trail at some point of a search.
+        struct Checkpoint{
+            alignas(32) uint16_t lanes[LANES];
+            int placed;
+        };
+
+        bool run(Grid& grid); // Places every forced digit in the grid, false on a contradiction
+        bool assume(Grid& grid, int cell, int val); // Places a guess and propagates from the current state
+
+        void checkpoint(Checkpoint& to) const; // Saves the state to come back to
+        void rollback(Grid& grid, const Checkpoint& to); // Undoes every placement and elimination made after to
+
+        int placed() const { return trail_size; }
+        int placed_cell(int i) const { return trail[i]; } // Cells filled by run and assume, in the order they were placed
+
+        uint16_t candidates(int cell) const { return lanes[cell] & Grid::ALL; }
+        int best_cell() const; // Unfilled cell with the fewest candidates, -1 if every cell is filled
+
+        static const char* kernel(); // Name of the kernel in use: "avx2", "sse4.1" or "scalar"
+        static bool select_kernel(const string& name); // Forces a kernel, false if unknown or not supported here
+
+    private:
+        bool propagate(Grid& grid);
+        bool assign(Grid& grid, int cell, int val);
+        bool naked_singles(Grid& grid, bool& progress);
+        bool hidden_singles(Grid& grid, bool& progress);
+        bool hidden_in_unit(Grid& grid, const int* cells, uint16_t once, uint16_t twice, bool& progress);
+        bool locked_candidates(bool& progress);
+        bool eliminate(int cell, uint16_t mask);
+
+        alignas(32) uint16_t lanes[LANES];
+        int trail[81];
+        int trail_size = 0;
+};
+
+#endif
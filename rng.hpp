@@ -0,0 +1,62 @@
+#ifndef RNG_H
+#define RNG_H
+#include <cstdint>
+
+using namespace std;
+
+/// @brief xoshiro256** pseudo random number generator.
+///         Small, fast and seedable, so every thread can own one and a seed always reproduces the same sequence. The
+///         state is expanded from a 64-bit seed with splitmix64 as recommended by its authors.
+class Rng{
+    public:
+
+        explicit Rng(uint64_t seed = 0) { reseed(seed); }
+
+        /// @brief Restarts the sequence from a seed.
+        void reseed(uint64_t seed){
+            for(int i = 0; i < 4; i++){
+                seed += 0x9E3779B97F4A7C15ULL;
+                uint64_t z = seed;
+                z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+                z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+                state[i] = z ^ (z >> 31);
+            }
+        }
+
+        /// @brief Returns the next 64 random bits.
+        uint64_t next(){
+            uint64_t result = rotate(state[1] * 5, 7) * 9;
+            uint64_t t = state[1] << 17;
+
+            state[2] ^= state[0];
+            state[3] ^= state[1];
+            state[1] ^= state[2];
+            state[0] ^= state[3];
+            state[2] ^= t;
+            state[3] = rotate(state[3], 45);
+            return result;
+        }
+
+        /// @brief Returns a number in [0, bound) using the multiply-shift range reduction, no division.
+        uint32_t below(uint32_t bound){
+            return (uint32_t)(((next() >> 32) * bound) >> 32);
+        }
+
+        /// @brief Shuffles an array in place (Fisher-Yates).
+        template<typename T>
+        void shuffle(T* values, int count){
+            for(int i = count - 1; i > 0; i--){
+                int j = below(i + 1);
+                T temp = values[i];
+                values[i] = values[j];
+                values[j] = temp;
+            }
+        }
+
+    private:
+        static uint64_t rotate(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+
+        uint64_t state[4];
+};
+
+#endif
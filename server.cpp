@@ -0,0 +1,447 @@
+#ifndef SERVER_CPP
+#define SERVER_CPP
+#include "server.hpp"
+#include "count.hpp"
+#include "generator.hpp"
+#include "thread_pool.hpp"
+#include "validate.hpp"
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <optional>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+
+static const size_t SERVER_BATCH = 4096; // Most requests handed to the pool in one round
+static const size_t SERVER_CHUNK = 16; // Requests per pool task, generate requests take milliseconds each
+static const size_t SERVER_READ = 1 << 16; // Bytes read from a client at a time
+static const size_t MAX_REQUEST = 1024; // Longest request line, a client sending more is disconnected
+
+static volatile sig_atomic_t server_stopping = 0;
+
+static void stop_server(int){
+    server_stopping = 1;
+}
+
+/// @brief One client: its file descriptors and the bytes waiting in each direction.
+struct Connection{
+    int in = -1;
+    int out = -1;
+    bool owns_fds = true; // False for standard input and output
+    vector<char> input; // Bytes read and not answered yet
+    size_t scanned = 0; // Bytes of input already split into requests of the current batch
+    vector<char> output; // Responses not written yet
+    bool closing = false; // The input ended or failed, closed once the output is written
+};
+
+/// @brief A request line of the current batch, and where its response went.
+struct Request{
+    size_t connection;
+    size_t begin; // Offset of the line in the input of its connection
+    size_t length;
+    int worker = 0; // Arena the response was written to
+    size_t reply_begin = 0;
+    size_t reply_end = 0;
+};
+
+/// @brief Everything a worker needs to answer requests, allocated once when the daemon starts and reused for every
+///         batch, so answering a request allocates nothing once the buffers have grown to their working size.
+struct ServerArena{
+    vector<char> out; // Responses written by this worker in the current batch
+    Rng rng; // Reseeded by every generate request
+};
+
+/// @brief Splits the next space separated word off a request.
+/// @return False if no word is left.
+static bool next_word(const char*& text, const char* end, const char*& word, size_t& length){
+    while(text < end && (*text == ' ' || *text == '\t')){
+        text++;
+    }
+    word = text;
+    while(text < end && *text != ' ' && *text != '\t'){
+        text++;
+    }
+    length = text - word;
+    return length > 0;
+}
+
+/// @brief Parses a number word of a request, false unless it is all digits.
+static bool number_word(const char* word, size_t length, uint64_t& number){
+    number = 0;
+    for(size_t i = 0; i < length; i++){
+        if(word[i] < '0' || word[i] > '9'){
+            return false;
+        }
+        number = number * 10 + (word[i] - '0');
+    }
+    return length > 0;
+}
+
+static void append_text(vector<char>& out, const char* text){
+    out.insert(out.end(), text, text + strlen(text));
+}
+
+/// @brief Answers one request line into the arena of the calling worker.
+/// @param line The request, without its newline.
+/// @param length The length of the line.
+/// @param options The engine and heuristic of the solve requests, and the budget of every request.
+/// @param arena The arena of the worker, receives the response line.
+static void answer_request(const char* line, size_t length, const ServerOptions& options, ServerArena& arena){
+
+    const char* end = line + length;
+    const char* command;
+    const char* board = nullptr;
+    const char* extra = nullptr;
+    size_t command_length, board_length = 0, extra_length = 0;
+
+    next_word(line, end, command, command_length);
+    next_word(line, end, board, board_length);
+    next_word(line, end, extra, extra_length);
+    string name(command, command_length);
+
+    Grid grid;
+    char text[81];
+    uint64_t number = 0;
+    optional<BudgetScope> budget;
+    if(options.budget.limited()){
+        budget.emplace(options.budget);
+    }
+
+    if(name == "solve" || name == "count"){
+        if(board_length != 81 || !grid.parse(board)){
+            append_text(arena.out, "error invalid puzzle\n");
+            return;
+        }
+        if(name == "solve"){
+            bool solved = solve_grid(grid, options.engine, options.heuristic);
+            if(budget_stopped()){
+                append_text(arena.out, "exhausted\n");
+            }
+            else if(solved){
+                grid.format(text);
+                arena.out.insert(arena.out.end(), text, text + 81);
+                arena.out.push_back('\n');
+            }
+            else{
+                append_text(arena.out, "none\n");
+            }
+            return;
+        }
+
+        number = 2;
+        if(extra_length > 0 && (!number_word(extra, extra_length, number) || number == 0 || number > INT32_MAX)){
+            append_text(arena.out, "error invalid limit\n");
+            return;
+        }
+        int count = count_solutions(grid, (int)number);
+        append_text(arena.out, budget_stopped() ? "exhausted\n" : (to_string(count) + "\n").c_str());
+    }
+    else if(name == "validate"){
+        if(board_length != 81 || (extra_length != 0 && extra_length != 81)){
+            append_text(arena.out, "malformed\n");
+            return;
+        }
+        const char* clues = extra_length ? extra : nullptr;
+        append_verdict(arena.out, check_flags(board, clues), board, clues);
+    }
+    else if(name == "generate"){
+        if(board_length > 0 && !number_word(board, board_length, number)){
+            append_text(arena.out, "error invalid seed\n");
+            return;
+        }
+        arena.rng.reseed(number);
+        generate_puzzle(arena.rng, grid);
+        if(budget_stopped()){
+            append_text(arena.out, "exhausted\n");
+            return;
+        }
+        grid.format(text);
+        arena.out.insert(arena.out.end(), text, text + 81);
+        arena.out.push_back('\n');
+    }
+    else{
+        append_text(arena.out, "error unknown request\n");
+    }
+}
+
+/// @brief Tells if a complete request line is waiting in the input of a connection.
+static bool has_line(const Connection& connection){
+    return !connection.input.empty() && memchr(connection.input.data(), '\n', connection.input.size()) != nullptr;
+}
+
+/// @brief Writes as much of the pending output of a connection as the descriptor takes without blocking.
+/// @return False if the client is gone.
+static bool flush_connection(Connection& connection){
+
+    size_t written = 0;
+    while(written < connection.output.size()){
+        ssize_t count = write(connection.out, connection.output.data() + written, connection.output.size() - written);
+        if(count < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            if(errno == EAGAIN || errno == EWOULDBLOCK){
+                break;
+            }
+            return false;
+        }
+        written += count;
+    }
+    connection.output.erase(connection.output.begin(), connection.output.begin() + written);
+    return true;
+}
+
+/// @brief Opens the listening socket, replacing a stale socket file left at the path.
+/// @return The descriptor, or -1 with the error printed.
+static int listen_socket(const string& path){
+
+    sockaddr_un address = {};
+    if(path.size() >= sizeof(address.sun_path)){
+        cerr << "ERROR: Socket path " << path << " is too long." << endl;
+        return -1;
+    }
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0){
+        cerr << "ERROR: Failed to create a socket: " << strerror(errno) << "." << endl;
+        return -1;
+    }
+    struct stat existing;
+    if(stat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)){
+        unlink(path.c_str());
+    }
+    if(bind(fd, (sockaddr*)&address, sizeof(address)) < 0 || listen(fd, SOMAXCONN) < 0){
+        cerr << "ERROR: Failed to listen on " << path << ": " << strerror(errno) << "." << endl;
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+/// @brief Collects the complete request lines of every connection into one batch, at most SERVER_BATCH of them. Lines
+///         are referenced in place in the input buffers, which are not touched until the batch is answered.
+/// @return True if lines were left for the next batch.
+static bool collect_requests(vector<Connection>& connections, vector<Request>& requests){
+
+    // A full batch stops before the later connections, so every offset is reset first: their input must not be
+    // erased with the offset of the previous batch.
+    requests.clear();
+    for(Connection& connection : connections){
+        connection.scanned = 0;
+    }
+    for(size_t c = 0; c < connections.size(); c++){
+        Connection& connection = connections[c];
+
+        while(requests.size() < SERVER_BATCH){
+            const char* start = connection.input.data() + connection.scanned;
+            size_t left = connection.input.size() - connection.scanned;
+            const char* newline = left ? (const char*)memchr(start, '\n', left) : nullptr;
+            if(newline == nullptr){
+                break;
+            }
+
+            size_t length = newline - start;
+            if(length > 0 && start[length - 1] == '\r'){
+                length--;
+            }
+            if(length > 0){
+                Request request;
+                request.connection = c;
+                request.begin = connection.scanned;
+                request.length = length;
+                requests.push_back(request);
+            }
+            connection.scanned += newline - start + 1;
+        }
+        if(requests.size() == SERVER_BATCH){
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief Serves solve, validate, count and generate requests until the input ends (standard input) or the process
+///         gets SIGINT or SIGTERM (socket). A single thread polls every client; whatever complete request lines are
+///         waiting on all of them are answered as one batch on the thread pool, split into chunks that write into the
+///         arena of the worker that runs them. The responses are then copied out to their clients in request order.
+///         Clients that send requests concurrently therefore share a batch, and the pool is kept busy by many small
+///         requests without one task per request.
+/// @param options The socket path, the number of threads and the solver settings.
+/// @return The number of requests and batches served.
+ServerResult run_server(const ServerOptions& options){
+
+    ServerResult result;
+    bool standard_io = options.socket == "-";
+    int listener = -1;
+
+    struct sigaction action = {};
+    action.sa_handler = stop_server;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    vector<Connection> connections;
+    if(standard_io){
+        Connection connection;
+        connection.in = STDIN_FILENO;
+        connection.out = STDOUT_FILENO;
+        connection.owns_fds = false;
+        connections.push_back(std::move(connection));
+        result.connections = 1;
+    }
+    else if((listener = listen_socket(options.socket)) < 0){
+        exit(EXIT_FAILURE);
+    }
+
+    ThreadPool pool(options.threads);
+    vector<ServerArena> arenas(pool.size());
+    for(ServerArena& arena : arenas){
+        arena.out.reserve(SERVER_BATCH / pool.size() * 128);
+    }
+
+    vector<Request> requests;
+    requests.reserve(SERVER_BATCH);
+    vector<pollfd> polled;
+    bool pending = false; // Complete requests are still waiting because the last batch was full
+    vector<char> buffer(SERVER_READ);
+
+    while(!server_stopping && (listener >= 0 || !connections.empty())){
+
+        // Wait for input, room to write or a new client. Leftover requests are answered without waiting.
+        polled.clear();
+        if(listener >= 0){
+            polled.push_back({listener, POLLIN, 0});
+        }
+        for(const Connection& connection : connections){
+            polled.push_back({connection.closing ? -1 : connection.in, POLLIN, 0});
+            polled.push_back({connection.output.empty() ? -1 : connection.out, POLLOUT, 0});
+        }
+        if(poll(polled.data(), polled.size(), pending ? 0 : -1) < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            cerr << "ERROR: poll failed: " << strerror(errno) << "." << endl;
+            break;
+        }
+
+        size_t first = 0;
+        if(listener >= 0){
+            first = 1;
+        }
+        for(size_t c = 0; c < connections.size(); c++){
+            Connection& connection = connections[c];
+            short readable = polled[first + 2 * c].revents;
+            short writable = polled[first + 2 * c + 1].revents;
+
+            if(readable & (POLLIN | POLLHUP | POLLERR)){
+                ssize_t count = read(connection.in, buffer.data(), buffer.size());
+                if(count > 0){
+                    connection.input.insert(connection.input.end(), buffer.data(), buffer.data() + count);
+                }
+                else if(count == 0 || (errno != EINTR && errno != EAGAIN)){
+                    // A last request the client ended without a newline still gets its answer.
+                    if(count == 0 && !connection.input.empty() && connection.input.back() != '\n'){
+                        connection.input.push_back('\n');
+                    }
+                    connection.closing = true;
+                }
+            }
+            if((writable & POLLOUT) && !flush_connection(connection)){
+                connection.closing = true;
+                connection.output.clear();
+                connection.input.clear();
+            }
+        }
+
+        if(listener >= 0 && (polled[0].revents & POLLIN)){
+            for(int fd; (fd = accept(listener, nullptr, nullptr)) >= 0;){
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                Connection connection;
+                connection.in = connection.out = fd;
+                connections.push_back(std::move(connection));
+                result.connections++;
+            }
+        }
+
+        // Answer every complete request waiting on any client as one batch.
+        pending = collect_requests(connections, requests);
+        if(!requests.empty()){
+            for(ServerArena& arena : arenas){
+                arena.out.clear();
+            }
+
+            for(size_t first_request = 0; first_request < requests.size(); first_request += SERVER_CHUNK){
+                pool.submit([&, first_request] {
+                    int worker = ThreadPool::current_worker();
+                    ServerArena& arena = arenas[worker];
+                    size_t last = min(first_request + SERVER_CHUNK, requests.size());
+
+                    for(size_t i = first_request; i < last; i++){
+                        Request& request = requests[i];
+                        request.worker = worker;
+                        request.reply_begin = arena.out.size();
+                        answer_request(connections[request.connection].input.data() + request.begin, request.length,
+                                       options, arena);
+                        request.reply_end = arena.out.size();
+                    }
+                });
+            }
+            pool.wait();
+
+            for(const Request& request : requests){
+                const vector<char>& out = arenas[request.worker].out;
+                vector<char>& reply = connections[request.connection].output;
+                reply.insert(reply.end(), out.begin() + request.reply_begin, out.begin() + request.reply_end);
+            }
+            result.requests += requests.size();
+            result.batches++;
+        }
+
+        // Drop the answered lines, write what the clients take, and close the finished ones.
+        for(size_t c = connections.size(); c-- > 0;){
+            Connection& connection = connections[c];
+            connection.input.erase(connection.input.begin(), connection.input.begin() + connection.scanned);
+
+            if(connection.input.size() > MAX_REQUEST && !has_line(connection)){
+                append_text(connection.output, "error request too long\n");
+                connection.input.clear();
+                connection.closing = true;
+            }
+            if(!connection.output.empty() && !flush_connection(connection)){
+                connection.output.clear();
+                connection.input.clear();
+                connection.closing = true;
+            }
+
+            if(connection.closing && connection.output.empty() && !has_line(connection)){
+                if(connection.owns_fds){
+                    close(connection.in);
+                }
+                connections.erase(connections.begin() + c);
+            }
+        }
+    }
+
+    for(Connection& connection : connections){
+        if(connection.owns_fds){
+            close(connection.in);
+        }
+    }
+    if(listener >= 0){
+        close(listener);
+        unlink(options.socket.c_str());
+    }
+    return result;
+}
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef SERVER_H
+#define SERVER_H
+#include <cstddef>
+#include <string>
+#include "budget.hpp"
+#include "engine.hpp"
+
+using namespace std;
+
+/// @brief Settings of the solver daemon.
+///         Clients send one request per line and get one response line per request, in the order sent:
+///           solve PUZZLE            the 81-character solution, or "none"
+///           validate BOARD [CLUES]  the verdict line of --validate
+///           count PUZZLE [LIMIT]    the number of solutions, counting stops at LIMIT (default 2)
+///           generate [SEED]         a puzzle with a unique solution, the first one --generate makes from SEED
+///         A request that cannot be parsed gets "error" and the reason, one that runs out of budget gets "exhausted".
+///         Only 9x9 boards are served. The last line before the client ends its input needs no newline.
+struct ServerOptions{
+    string socket; // Path of the Unix domain socket to listen on, "-" to serve standard input and output
+    unsigned threads = 0; // Worker threads, 0 for one per core
+    Engine engine = Engine::backtrack; // Engine of the solve requests
+    Heuristic heuristic = Heuristic::first; // Branching heuristic of the backtrack engine
+    Budget budget; // Node and time limits of every solve, count and generate request, none by default
+};
+
+/// @brief Totals reported when the daemon stops.
+struct ServerResult{
+    size_t requests = 0;
+    size_t batches = 0; // Rounds of requests handed to the pool together
+    size_t connections = 0;
+};
+
+ServerResult run_server(const ServerOptions& options); // Serves until the input ends or SIGINT/SIGTERM
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef SESSION_CPP
+#define SESSION_CPP
+#include "session.hpp"
+#include "count.hpp"
+
+/// @brief Returns the name of a hint kind.
+const char* hint_kind_name(HintKind kind){
+    switch(kind){
+        case HintKind::naked_single: return "naked_single";
+        case HintKind::hidden_single: return "hidden_single";
+        case HintKind::solution: return "solution";
+        case HintKind::mistake: return "mistake";
+        case HintKind::none: return "none";
+    }
+    return "unknown";
+}
+
+/// @brief Starts a session on a puzzle: solves it and finds out whether the solution is unique, the only searches a
+///         session on a unique puzzle ever makes.
+/// @param puzzle The puzzle, must have consistent givens.
+/// @param budget Limits of every search of the session. A uniqueness check that runs out of it counts the puzzle as
+///         having several solutions, which only costs searches later, never a wrong answer.
+/// @return False if the puzzle has no solution or the solve ran out of budget, the session is then unusable.
+bool PlaySession::start(const Grid& puzzle, const Budget& budget){
+
+    BoundedResult<3> solved = solve_bounded(puzzle, budget);
+    if(solved.outcome != Outcome::solved){
+        return false;
+    }
+    BoundedResult<3> counted = count_bounded(puzzle, 2, budget);
+
+    this->puzzle = puzzle;
+    this->budget = budget;
+    current = puzzle;
+    answer = solved.grid;
+    unique_puzzle = counted.outcome == Outcome::solved && counted.count == 1;
+    wrong = 0;
+    filled = 0;
+    for(int cell = 0; cell < 81; cell++){
+        filled += puzzle.get(cell) != 0;
+    }
+    return true;
+}
+
+/// @brief Collects the peers (row, column and box) of a cell that hold a digit.
+/// @param peers Receives the peer cells, at most 20.
+/// @return The number of peers found.
+int PlaySession::conflicts(int cell, int val, int peers[20]) const{
+    int count = 0;
+    for(int peer : UNITS.peers[cell]){
+        if(current.get(peer) == val){
+            peers[count++] = peer;
+        }
+    }
+    return count;
+}
+
+/// @brief Tells what set would do with a move, without making it. On a puzzle with one solution this is a few
+///         comparisons; with several, a move away from the solution kept so far is tried on a copy of the session.
+Move PlaySession::check(int cell, int val) const{
+
+    if(cell < 0 || cell > 80 || val < 1 || val > 9){
+        return Move::invalid;
+    }
+    if(puzzle.get(cell) != 0){
+        return Move::given;
+    }
+    int peers[20];
+    if(conflicts(cell, val, peers) > 0){
+        return Move::conflict;
+    }
+
+    int others = wrong - (current.get(cell) != 0 && current.get(cell) != answer.get(cell));
+    if(unique_puzzle || (others == 0 && val == answer.get(cell))){
+        return others == 0 && val == answer.get(cell) ? Move::ok : Move::wrong;
+    }
+    PlaySession copy = *this;
+    return copy.set(cell, val);
+}
+
+/// @brief Puts a digit in a cell, replacing the digit the player had there.
+/// @return ok or wrong if the move was made; conflict, given or invalid if it was refused and nothing changed.
+Move PlaySession::set(int cell, int val){
+
+    if(cell < 0 || cell > 80 || val < 1 || val > 9){
+        return Move::invalid;
+    }
+    if(puzzle.get(cell) != 0){
+        return Move::given;
+    }
+    int peers[20];
+    if(conflicts(cell, val, peers) > 0){
+        return Move::conflict;
+    }
+
+    if(current.get(cell) != 0){
+        wrong -= current.get(cell) != answer.get(cell);
+        current.unplace(cell);
+        filled--;
+    }
+    current.place(cell, val);
+    filled++;
+    wrong += val != answer.get(cell);
+
+    if(wrong > 0 && !unique_puzzle){
+        follow();
+    }
+    return wrong == 0 ? Move::ok : Move::wrong;
+}
+
+/// @brief Empties a cell the player filled. Givens and empty cells are left as they are.
+void PlaySession::clear(int cell){
+
+    if(cell < 0 || cell > 80 || puzzle.get(cell) != 0 || current.get(cell) == 0){
+        return;
+    }
+    wrong -= current.get(cell) != answer.get(cell);
+    current.unplace(cell);
+    filled--;
+
+    if(wrong > 0 && !unique_puzzle){
+        follow();
+    }
+}
+
+/// @brief Tells if the board can still be completed in exactly one way. Free on a puzzle with one solution; with
+///         several, the board as it is gets counted up to 2.
+bool PlaySession::unique(){
+
+    if(wrong > 0){
+        return false;
+    }
+    if(unique_puzzle){
+        return true;
+    }
+    BoundedResult<3> counted = count_bounded(current, 2, budget);
+    return counted.outcome == Outcome::solved && counted.count == 1;
+}
+
+/// @brief Finds the next step for the player. A digit that disagrees with the solution comes first; then a naked
+///         single, then a hidden single, and when the board needs more than singles, the solution's digit for the
+///         empty cell with the fewest candidates.
+Hint PlaySession::hint() const{
+
+    Hint hint;
+    if(wrong > 0){
+        for(int cell = 0; cell < 81; cell++){
+            if(current.get(cell) != 0 && current.get(cell) != answer.get(cell)){
+                return {cell, answer.get(cell), HintKind::mistake};
+            }
+        }
+    }
+
+    // Naked singles, keeping the cell with the fewest candidates for the last resort.
+    int fewest = 10;
+    for(int cell = 0; cell < 81; cell++){
+        if(current.get(cell) == 0){
+            Grid::Mask mask = current.candidates(cell);
+            int count = __builtin_popcount(mask);
+            if(count == 1){
+                return {cell, __builtin_ctz(mask) + 1, HintKind::naked_single};
+            }
+            if(count < fewest){
+                fewest = count;
+                hint = {cell, answer.get(cell), HintKind::solution};
+            }
+        }
+    }
+    if(hint.cell == -1){
+        return hint;
+    }
+
+    for(const int* unit : UNITS.cells){
+        Grid::Mask once = 0;
+        Grid::Mask twice = 0;
+        Grid::Mask placed = 0;
+        for(int i = 0; i < 9; i++){
+            if(current.get(unit[i]) != 0){
+                placed |= 1u << (current.get(unit[i]) - 1);
+                continue;
+            }
+            Grid::Mask mask = current.candidates(unit[i]);
+            twice |= once & mask;
+            once |= mask;
+        }
+
+        Grid::Mask single = once & ~twice & ~placed;
+        if(single != 0){
+            single &= -single;
+            for(int i = 0; i < 9; i++){
+                if(current.get(unit[i]) == 0 && (current.candidates(unit[i]) & single)){
+                    return {unit[i], __builtin_ctz(single) + 1, HintKind::hidden_single};
+                }
+            }
+        }
+    }
+    return hint;
+}
+
+/// @brief Solves the board as it stands and, if that works, compares the board against the new solution from now on.
+///         Only used on puzzles with several solutions, where a digit away from the old solution may fit another one.
+/// @return True if the board has a solution within the budget.
+bool PlaySession::follow(){
+    BoundedResult<3> solved = solve_bounded(current, budget);
+    if(solved.outcome != Outcome::solved){
+        return false;
+    }
+    answer = solved.grid;
+    recount();
+    return true;
+}
+
+void PlaySession::recount(){
+    wrong = 0;
+    for(int cell = 0; cell < 81; cell++){
+        wrong += current.get(cell) != 0 && current.get(cell) != answer.get(cell);
+    }
+}
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef SESSION_H
+#define SESSION_H
+#include <cstdint>
+#include "budget.hpp"
+#include "grid.hpp"
+
+using namespace std;
+
+/// @brief What a move does to the board of a session.
+enum class Move : uint8_t{
+    ok, // Legal and the board can still be solved
+    wrong, // Legal, but the board no longer has a solution
+    conflict, // A peer already holds the digit, the move is not made
+    given, // The cell is a given of the puzzle and cannot change
+    invalid // The cell or the digit is out of range
+};
+
+/// @brief How a hint was found.
+enum class HintKind : uint8_t{
+    naked_single, // The cell has one candidate left
+    hidden_single, // The digit has one place left in a row, column or box
+    solution, // No single is left, the digit is read from the solution
+    mistake, // The cell holds a digit the solution does not, the hint is its right digit
+    none // The board is full and correct
+};
+
+const char* hint_kind_name(HintKind kind); // "naked_single", "hidden_single", "solution", "mistake" or "none"
+
+/// @brief A hint: the digit to put in a cell, and the technique that finds it.
+struct Hint{
+    int cell = -1; // -1 with none
+    int val = 0;
+    HintKind kind = HintKind::none;
+};
+
+/// @brief One interactive play of a 9x9 puzzle. The puzzle is solved once when the session starts; afterwards every
+///         move only updates the candidate masks of the board and a count of the cells that disagree with the solution,
+///         so the questions a game asks after each keystroke (is the move legal, can the board still be solved, is the
+///         solution still unique, what is the next logical step) are answered from that state without a search.
+///         Only a puzzle with several solutions needs a search again, when the player leaves the solution kept so far.
+class PlaySession{
+    public:
+
+        bool start(const Grid& puzzle, const Budget& budget = Budget()); // Solves the puzzle, false if it has none
+
+        Move check(int cell, int val) const; // What set would return, without making the move
+        Move set(int cell, int val); // Puts a digit in a cell, replacing the player's digit there
+        void clear(int cell); // Empties a cell the player filled, givens are left alone
+        int conflicts(int cell, int val, int peers[20]) const; // Peers of the cell holding val, returns how many
+
+        bool solvable() const { return wrong == 0; } // The board can still be completed
+        bool unique(); // The board can still be completed in exactly one way
+        bool complete() const { return filled == 81 && wrong == 0; } // Solved
+        Hint hint() const; // The next step: a mistake to undo, then singles, then the solution
+
+        const Grid& board() const { return current; }
+        const Grid& solution() const { return answer; }
+
+    private:
+        bool follow(); // Solves the board as it is and keeps that solution, for puzzles with several
+        void recount(); // Counts the filled cells that disagree with the solution
+
+        Grid puzzle; // The givens
+        Grid current; // Givens and the player's digits
+        Grid answer; // The solution the board is compared against
+        Budget budget; // Limits of the searches the session makes
+        bool unique_puzzle = false; // The puzzle has one solution, so every board that leaves it is unsolvable
+        int wrong = 0; // Filled cells that disagree with answer
+        int filled = 0;
+};
+
+#endif
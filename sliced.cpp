@@ -0,0 +1,240 @@
+#ifndef SLICED_CPP
+#define SLICED_CPP
+#include "sliced.hpp"
+#include <algorithm>
+
+/*                                                 Vector kernels                                                                */
+
+// A kernel propagates one group of boards in place. masks holds 81 rows of width lanes, row cell holds the candidates
+// of that cell in every board; a lane with no candidates left in some cell is a board with a contradiction.
+struct SlicedKernel{
+    const char* name;
+    int width; // Boards per group
+    void (*propagate)(uint16_t* masks);
+};
+
+static const int SLICED_MAX_WIDTH = 32;
+
+// Lanes of the kernels as GCC vector types. The operators act on every lane, the compiler emits them with the
+// instructions of the function they are inlined into: zmm registers under avx512bw, ymm under avx2, and the baseline
+// instructions (SSE2 on x86-64, plain integer code elsewhere) for the scalar kernel.
+typedef uint16_t Lanes8 __attribute__((vector_size(16)));
+typedef uint16_t Lanes16 __attribute__((vector_size(32)));
+typedef uint16_t Lanes32 __attribute__((vector_size(64)));
+
+/// @brief Runs unit passes until no lane changes. A pass goes over the 27 units; for each unit it collects the digits
+///         that are candidates once and more than once and the digits of the cells down to a single candidate, then:
+///          - naked singles: the digit of a single cell is taken out of the other cells of the unit,
+///          - hidden singles: a cell holding the only place of a digit keeps just that digit, or none if it holds the
+///            only place of two digits,
+///          - a digit without a place, or two single cells with the same digit, empties the first cell of the unit.
+///         Candidates only ever shrink, so the passes end. Every lane runs every step; a settled board costs the same
+///         as a busy one, which is what keeps the loop free of branches on the boards.
+template<typename Lanes>
+__attribute__((always_inline))
+static inline void propagate_lanes(uint16_t* masks){
+
+    const int width = sizeof(Lanes) / sizeof(uint16_t);
+    const Lanes zero = {};
+    const Lanes all = zero + Grid::ALL;
+    Lanes* cells = (Lanes*)masks;
+
+    uint16_t progress = 1;
+    while(progress){
+        Lanes changed = zero;
+
+        for(int unit = 0; unit < 27; unit++){
+            const int* unit_cells = UNITS.cells[unit];
+            Lanes once = zero;
+            Lanes twice = zero;
+            Lanes fixed = zero;
+            Lanes fixed_twice = zero;
+
+            #pragma GCC unroll 9
+            for(int i = 0; i < 9; i++){
+                Lanes x = cells[unit_cells[i]];
+                Lanes single = x & (Lanes)((x & (x - 1)) == 0);
+                twice |= once & x;
+                once |= x;
+                fixed_twice |= fixed & single;
+                fixed |= single;
+            }
+            Lanes exactly_once = once & ~twice;
+            Lanes broken = (Lanes)(once != all) | (Lanes)(fixed_twice != 0);
+
+            #pragma GCC unroll 9
+            for(int i = 0; i < 9; i++){
+                Lanes x = cells[unit_cells[i]];
+                Lanes single = x & (Lanes)((x & (x - 1)) == 0);
+                Lanes next = x & ~(fixed & ~single);
+
+                Lanes hidden = next & exactly_once;
+                Lanes has_hidden = (Lanes)(hidden != 0);
+                Lanes several = (Lanes)((hidden & (hidden - 1)) != 0);
+                next = ((hidden & has_hidden) | (next & ~has_hidden)) & ~several;
+                if(i == 0){
+                    next &= ~broken;
+                }
+
+                changed |= x ^ next;
+                cells[unit_cells[i]] = next;
+            }
+        }
+
+        progress = 0;
+        for(int lane = 0; lane < width; lane++){
+            progress |= changed[lane];
+        }
+    }
+}
+
+static void propagate_scalar(uint16_t* masks){
+    propagate_lanes<Lanes8>(masks);
+}
+
+__attribute__((target("avx2")))
+static void propagate_avx2(uint16_t* masks){
+    propagate_lanes<Lanes16>(masks);
+}
+
+__attribute__((target("avx512bw")))
+static void propagate_avx512(uint16_t* masks){
+    propagate_lanes<Lanes32>(masks);
+}
+
+static const SlicedKernel SCALAR_SLICED = {"scalar", 8, propagate_scalar};
+static const SlicedKernel AVX2_SLICED = {"avx2", 16, propagate_avx2};
+static const SlicedKernel AVX512_SLICED = {"avx512", 32, propagate_avx512};
+
+/// @brief Picks the widest kernel the CPU supports.
+static const SlicedKernel* detect_sliced_kernel(){
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512bw")){
+        return &AVX512_SLICED;
+    }
+    if(__builtin_cpu_supports("avx2")){
+        return &AVX2_SLICED;
+    }
+    return &SCALAR_SLICED;
+}
+
+static const SlicedKernel* sliced = detect_sliced_kernel();
+
+/// @brief Returns the name of the sliced kernel in use.
+const char* sliced_kernel(){
+    return sliced->name;
+}
+
+/// @brief Returns the number of boards the kernel in use propagates together.
+int sliced_width(){
+    return sliced->width;
+}
+
+/// @brief Forces a sliced kernel, used to compare them on the same input. Not meant to be called while boards are being
+///         propagated.
+/// @param name "avx512", "avx2", "scalar", or "auto" for the widest supported one.
+/// @return True if the kernel exists and this CPU supports it.
+bool select_sliced_kernel(const string& name){
+    if(name == "auto"){
+        sliced = detect_sliced_kernel();
+    }
+    else if(name == "scalar"){
+        sliced = &SCALAR_SLICED;
+    }
+    else if(name == "avx2" && __builtin_cpu_supports("avx2")){
+        sliced = &AVX2_SLICED;
+    }
+    else if(name == "avx512" && __builtin_cpu_supports("avx512bw")){
+        sliced = &AVX512_SLICED;
+    }
+    else{
+        return false;
+    }
+    return true;
+}
+
+/*                                                 Batch propagation                                                             */
+
+/// @brief Reads the lane of one board back after propagation and fills in the cells it forced.
+/// @param lane The first row entry of the board, rows are width entries apart.
+static SlicedState settle_board(Grid& grid, const uint16_t* lane, int width){
+
+    bool complete = true;
+    for(int cell = 0; cell < 81; cell++){
+        uint16_t mask = lane[cell * width];
+        if(mask == 0){
+            return SlicedState::unsolvable;
+        }
+        complete = complete && (mask & (mask - 1)) == 0;
+    }
+
+    // At the fixed point no two single cells of a unit share a digit, so the forced digits are legal placements.
+    for(int cell = 0; cell < 81; cell++){
+        uint16_t mask = lane[cell * width];
+        if(grid.get(cell) == 0 && (mask & (mask - 1)) == 0){
+            grid.place(cell, __builtin_ctz(mask) + 1);
+        }
+    }
+    return complete ? SlicedState::solved : SlicedState::open;
+}
+
+/// @brief Propagates boards in groups of sliced_width(). Lanes past the last board of a group are left without
+///         candidates, which no deduction can change.
+/// @param grids The puzzles, must have consistent givens. The solved and open ones receive the forced digits.
+/// @param count Number of puzzles.
+/// @param states Receives the state of every puzzle.
+void propagate_sliced(Grid* grids, size_t count, SlicedState* states){
+
+    const SlicedKernel* kernel = sliced;
+    const int width = kernel->width;
+    alignas(64) uint16_t masks[81 * SLICED_MAX_WIDTH];
+
+    for(size_t first = 0; first < count; first += width){
+        int boards = (int)min<size_t>(width, count - first);
+
+        for(int cell = 0; cell < 81; cell++){
+            uint16_t* row = masks + cell * width;
+            for(int lane = 0; lane < width; lane++){
+                int val = lane < boards ? grids[first + lane].get(cell) : 0;
+                row[lane] = lane >= boards ? 0 : val ? (uint16_t)(1u << (val - 1)) : Grid::ALL;
+            }
+        }
+
+        kernel->propagate(masks);
+
+        for(int lane = 0; lane < boards; lane++){
+            states[first + lane] = settle_board(grids[first + lane], masks + lane, width);
+        }
+    }
+}
+
+/// @brief Solves puzzles with propagate_sliced, then sends only the boards it left open to the backtracking search.
+/// @param grids The puzzles, must have consistent givens. The solved ones receive their solution.
+/// @param count Number of puzzles.
+/// @param solved Receives for every puzzle whether it was solved. An unsolved grid is left as it was.
+/// @return The number of puzzles solved.
+size_t solve_sliced(Grid* grids, size_t count, bool* solved){
+
+    const size_t group = SLICED_MAX_WIDTH;
+    Grid puzzles[group];
+    SlicedState states[group];
+    size_t total = 0;
+
+    for(size_t first = 0; first < count; first += group){
+        size_t boards = min(group, count - first);
+        copy(grids + first, grids + first + boards, puzzles);
+        propagate_sliced(grids + first, boards, states);
+
+        for(size_t i = 0; i < boards; i++){
+            Grid& grid = grids[first + i];
+            solved[first + i] = states[i] == SlicedState::solved || (states[i] == SlicedState::open && grid.solve());
+            if(!solved[first + i]){
+                grid = puzzles[i];
+            }
+            total += solved[first + i];
+        }
+    }
+    return total;
+}
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef SLICED_H
+#define SLICED_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "grid.hpp"
+
+using namespace std;
+
+/// @brief How a board came out of propagate_sliced.
+enum class SlicedState : uint8_t{
+    solved, // Every cell was forced, the grid holds the solution
+    unsolvable, // Propagation hit a contradiction, the grid is left as it was
+    open // Propagation stalled, the grid holds the forced digits and still needs a search
+};
+
+/// @brief Constraint propagation of many 9x9 boards in lockstep, one board per 16-bit lane of a vector.
+///         The candidate masks are laid out structure-of-arrays, a vector of lanes per cell, so every unit pass works on
+///         32 boards at once with AVX-512, 16 with AVX2 and 8 with the scalar kernel, without a branch on the contents
+///         of any one board. Deductions: naked singles and hidden singles, repeated until no lane changes. The kernel is
+///         picked at runtime from what the CPU supports.
+void propagate_sliced(Grid* grids, size_t count, SlicedState* states);
+
+size_t solve_sliced(Grid* grids, size_t count, bool* solved); // propagate_sliced, then Grid::solve on the open boards
+
+const char* sliced_kernel(); // Name of the kernel in use: "avx512", "avx2" or "scalar"
+int sliced_width(); // Boards the kernel in use propagates per step
+bool select_sliced_kernel(const string& name); // Forces a kernel, false if unknown or not supported here
+
+#endif
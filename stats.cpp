@@ -0,0 +1,81 @@
+#ifndef STATS_CPP
+#define STATS_CPP
+#include "stats.hpp"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+/// @brief Adds the counters and timers of another set of stats. max_depth keeps the larger of the two.
+/// @param other The stats to add.
+void SearchStats::merge(const SearchStats& other){
+    nodes += other.nodes;
+    backtracks += other.backtracks;
+    candidates_tried += other.candidates_tried;
+    eliminations += other.eliminations;
+    max_depth = max(max_depth, other.max_depth);
+    uniqueness_checks += other.uniqueness_checks;
+    puzzles += other.puzzles;
+
+    parse_seconds += other.parse_seconds;
+    validate_seconds += other.validate_seconds;
+    solve_seconds += other.solve_seconds;
+    generate_seconds += other.generate_seconds;
+}
+
+/// @brief Formats the stats as a single-line JSON object.
+string SearchStats::json() const{
+    stringstream out;
+    out << "{\"puzzles\": " << puzzles << ", \"nodes\": " << nodes << ", \"backtracks\": " << backtracks
+        << ", \"candidates_tried\": " << candidates_tried << ", \"eliminations\": " << eliminations
+        << ", \"max_depth\": " << max_depth << ", \"uniqueness_checks\": " << uniqueness_checks
+        << ", \"seconds\": {\"parse\": " << parse_seconds << ", \"validate\": " << validate_seconds
+        << ", \"solve\": " << solve_seconds << ", \"generate\": " << generate_seconds << "}}";
+    return out.str();
+}
+
+/// @brief Formats the stats in the Prometheus text exposition format, counters end in _total.
+/// @param prefix The metric name prefix.
+string SearchStats::prometheus(const string& prefix) const{
+    stringstream out;
+
+    auto counter = [&](const char* name, const char* help, uint64_t value){
+        out << "# HELP " << prefix << "_" << name << "_total " << help << "\n";
+        out << "# TYPE " << prefix << "_" << name << "_total counter\n";
+        out << prefix << "_" << name << "_total " << value << "\n";
+    };
+
+    counter("puzzles", "Puzzles processed.", puzzles);
+    counter("search_nodes", "Search nodes visited.", nodes);
+    counter("backtracks", "Guesses taken back.", backtracks);
+    counter("candidates_tried", "Digits placed as guesses.", candidates_tried);
+    counter("eliminations", "Candidates removed by propagation.", eliminations);
+    counter("uniqueness_checks", "Uniqueness tests made by the generator.", uniqueness_checks);
+
+    out << "# HELP " << prefix << "_max_depth Deepest search recursion.\n";
+    out << "# TYPE " << prefix << "_max_depth gauge\n";
+    out << prefix << "_max_depth " << max_depth << "\n";
+
+    out << "# HELP " << prefix << "_phase_seconds_total Wall time spent in each phase.\n";
+    out << "# TYPE " << prefix << "_phase_seconds_total counter\n";
+    out << prefix << "_phase_seconds_total{phase=\"parse\"} " << parse_seconds << "\n";
+    out << prefix << "_phase_seconds_total{phase=\"validate\"} " << validate_seconds << "\n";
+    out << prefix << "_phase_seconds_total{phase=\"solve\"} " << solve_seconds << "\n";
+    out << prefix << "_phase_seconds_total{phase=\"generate\"} " << generate_seconds << "\n";
+    return out.str();
+}
+
+/// @brief Writes aggregated stats to a file.
+/// @param path The file to write.
+/// @param stats The stats.
+/// @param prometheus True for the Prometheus text format, false for JSON.
+/// @return False if the file cannot be opened.
+bool write_stats(const string& path, const SearchStats& stats, bool prometheus){
+    ofstream File(path);
+    if(!File.is_open()){
+        return false;
+    }
+    File << (prometheus ? stats.prometheus() : stats.json() + "\n");
+    return true;
+}
+
+#endif
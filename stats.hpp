@@ -0,0 +1,78 @@
+#ifndef STATS_H
+#define STATS_H
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+/// @brief Search counters and phase timings of the solver.
+///         Every thread accumulates into its own thread_stats, so multithreaded runs never share a counter; callers
+///         take a copy per puzzle and merge the copies. The counters are only compiled in when SUDOKU_STATS is defined
+///         (g++ -DSUDOKU_STATS ...). Without it the STAT_* macros expand to nothing and cost nothing.
+struct SearchStats{
+    uint64_t nodes = 0; // Search nodes visited, over all engines
+    uint64_t backtracks = 0; // Guesses taken back
+    uint64_t candidates_tried = 0; // Digits placed as guesses
+    uint64_t eliminations = 0; // Candidates removed by propagation
+    uint64_t max_depth = 0; // Deepest recursion of the search
+    uint64_t uniqueness_checks = 0; // Uniqueness tests made while removing cells in the generator
+    uint64_t puzzles = 0; // Puzzles merged into these stats
+
+    double parse_seconds = 0; // Reading and parsing puzzles
+    double validate_seconds = 0; // puzzle_ready validation
+    double solve_seconds = 0;
+    double generate_seconds = 0;
+
+    void merge(const SearchStats& other); // Adds another set of stats, max_depth takes the maximum
+
+    string json() const; // One JSON object
+    string prometheus(const string& prefix = "sudoku") const; // Prometheus text exposition format
+};
+
+bool write_stats(const string& path, const SearchStats& stats, bool prometheus); // Writes JSON or Prometheus text
+
+inline thread_local SearchStats thread_stats; // Stats of the calling thread
+inline thread_local uint64_t search_depth = 0; // Current recursion depth, feeds max_depth
+
+#ifdef SUDOKU_STATS
+
+inline constexpr bool STATS_ENABLED = true;
+
+/// @brief Adds the wall time of a scope to one of the phase timers of thread_stats.
+class PhaseTimer{
+    public:
+        explicit PhaseTimer(double SearchStats::* field) : field(field), start(chrono::steady_clock::now()) {}
+        ~PhaseTimer() { thread_stats.*field += chrono::duration<double>(chrono::steady_clock::now() - start).count(); }
+
+    private:
+        double SearchStats::* field;
+        chrono::steady_clock::time_point start;
+};
+
+/// @brief Tracks the search depth of a scope and records the deepest one.
+class DepthGuard{
+    public:
+        DepthGuard(){
+            if(++search_depth > thread_stats.max_depth){
+                thread_stats.max_depth = search_depth;
+            }
+        }
+        ~DepthGuard() { search_depth--; }
+};
+
+#define STAT_ADD(field, amount) (thread_stats.field += (amount))
+#define STAT_PHASE(field) PhaseTimer stat_phase_timer(&SearchStats::field)
+#define STAT_DEPTH() DepthGuard stat_depth_guard
+
+#else
+
+inline constexpr bool STATS_ENABLED = false;
+
+#define STAT_ADD(field, amount) ((void)0)
+#define STAT_PHASE(field) ((void)0)
+#define STAT_DEPTH() ((void)0)
+
+#endif
+
+#endif
@@ -1,10 +1,9 @@
 #ifndef SUDOKU_CPP
 #define SUDOKU_CPP
 #include "sudoku.hpp"
-#include <vector>
 #include <stdio.h>
+#include <cctype>
 #include <cstdlib>
-#include <fstream>
 #include <algorithm>
 #include <random>
 #include <ctime>
@@ -49,13 +48,11 @@ Sudoku::Sudoku() {
         cout << "Reading from: ";
         cin >> file_in; 
 
-        ifstream File;
-        File.open(file_in);
+        MappedFile File;
 
         // Handle invalid text file
-        if(!File.is_open()) {
+        if(!File.open(file_in)) {
             cerr << "ERROR: Failed to open the file, check if file exists and try again." << endl;
-            File.close();
             exit(EXIT_FAILURE);
         }
 
@@ -65,7 +62,7 @@ Sudoku::Sudoku() {
         cout << endl;
         
         // reads from the file and creates the board
-        create_board(file_in);
+        create_board(File, file_in);
 
         // Checks if the puzzle provided is valid
         if(puzzle_ready()){
@@ -84,6 +81,15 @@ Sudoku::Sudoku() {
             print_board();
             cout << endl;
             cerr << "ERROR: Invalid puzzle. repeated number in the horizontal, vertical, or box." << endl;
+
+            // Lists the cells holding a repeated number, counting rows and columns from 1.
+            cerr << "Conflicting cells (row, column):";
+            for(int cell = 0; cell < 81; cell++){
+                if(board_check.conflicts[cell >> 6] >> (cell & 63) & 1){
+                    cerr << " (" << cell / 9 + 1 << ", " << cell % 9 + 1 << ")";
+                }
+            }
+            cerr << endl;
             
         }
         
@@ -92,7 +98,7 @@ Sudoku::Sudoku() {
     // If user chooses to generate a puzzle
     else{
         
-        srand(time(nullptr));
+        rng.reseed(time(nullptr) ^ random_device()());
         cout <<"- - - - - - - - - - - - CREATING BOARD - - - - - - - - - - - - " << endl;
         cout << endl;
 
@@ -114,27 +120,50 @@ Sudoku::Sudoku() {
     }
 
     cout << endl;
+
+    // Search counters and phase timings, only when built with -DSUDOKU_STATS
+    if(STATS_ENABLED){
+        thread_stats.puzzles = 1;
+        cerr << "Stats: " << thread_stats.json() << endl;
+    }
 }
 
 
-/// @brief Reads the puzzle values from the text file and populate the board. Also makes sure that all 81 values are provided and 
-///         values are between 0 and 9.
-/// @param text_file Takes in a string type that holds the name of the text file with the puzzle in it.
-void Sudoku::create_board(string text_file){
+/// @brief Reads the puzzle values from the text file into board_text. Also makes sure that all 81 values are provided and 
+///         values are between 0 and 9. The numbers are parsed straight out of the mapped file.
+/// @param File The memory mapped text file with the puzzle in it.
+/// @param text_file Takes in a string type that holds the name of the text file, used in error messages.
+void Sudoku::create_board(const MappedFile& File, string text_file){
     
-    int value;
-    ifstream File;
-    File.open(text_file);
+    STAT_PHASE(parse_seconds);
+
+    const char* position = File.data();
+    const char* end = position + File.size();
 
     // Read the puzzle values from the text file and populate the board
     for(int row = 0; row < 9; row++){
         for(int column = 0; column < 9; column++){
-            if((File >> value) && (value >= 0) && (value < 10)){
-                board[row][column] = value;
+
+            // Skip the spaces and line breaks between the numbers.
+            while(position < end && isspace((unsigned char)*position)){
+                position++;
+            }
+
+            // Read one number, with an optional sign.
+            bool negative = position < end && *position == '-';
+            const char* digits = position + negative;
+            long value = 0;
+            for(position = digits; position < end && isdigit((unsigned char)*position); position++){
+                value = min(value * 10 + (*position - '0'), 100L);
+            }
+            bool number = position > digits && (position == end || isspace((unsigned char)*position));
+
+            if(number && !negative && value < 10){
+                board_text[row * 9 + column] = char('0' + value);
             }
             else{
                 // Handles invalid values and exits the program
-                if(value < 0 || value >= 10){
+                if(number){
                     cerr << "ERROR: The puzzle must be filled with numbers ranging from 0 to 9." << endl;
                 }
                 // Handles invalid case where the board had less than 81 values 
@@ -142,260 +171,68 @@ void Sudoku::create_board(string text_file){
                     cerr << "ERROR: Please make sure you provide the full puzzle in the " << text_file 
                             << " file, 81 numbers separated by space." << endl;
                 }
-                File.close();
                 exit(EXIT_FAILURE);
             }
         }
     }
-
-    File.close();
-
 }
 
-/// @brief This function formats and prints the current state of the Sudoku board to the console
+/// @brief This function formats and prints board_text to the console, blanks as 0. The board is formatted into one
+///         buffer and written with a single flush.
 void Sudoku::print_board(){
+
+    char text[512];
+    int length = 0;
  
     for(int row = 0; row < 9; row++) {
         if(row % 3 == 0 && row != 0) {
-            cout << "- - - - - - - - - - - - " << endl;
+            length += sprintf(text + length, "- - - - - - - - - - - - \n");
         }
 
         for(int column = 0; column < 9; column++) {
 
             if(column % 3 == 0 && column != 0) {
-                cout << " | ";
+                length += sprintf(text + length, " | ");
             }
 
-            if(column == 8) {
-                cout << to_string(board[row][column]);
-            }
-            else{
-                cout << to_string(board[row][column]) << " ";
+            char value = board_text[row * 9 + column];
+            text[length++] = value == '.' ? '0' : value;
+            if(column != 8) {
+                text[length++] = ' ';
             }
         }
-            cout << endl;  
-    }
-    
-    cout << endl;
-    
-}
-
-
-/*                                     Code for checking if the provided puzzle is valid                                         */
-
-
-/// @brief Checks if the puzzle violates the rule of repeated value in a horizontal, vertical or box area.
-/// @param curr_board Takes in the current board as a 2D array.
-/// @param position Takes in the position of the value as a pair to check if values are repeated
-/// @return True if valid, False if not
-bool Sudoku::valid_puzzle(int curr_board[9][9], pair<int, int> position) {
-    //check through each column in the row to see if the value exists more than once
-    int val = curr_board[position.first][position.second];
-
-    for(int column = 0; column < 9; column++){
-        if( (curr_board[position.first][column] == val) &&  position.second != column) {
-            return false;
-        }
-    }
-
-    //check through each row in the column to see if the value exists more than once
-    for(int row = 0; row < 9; row++){
-        if( (curr_board[row][position.second]) == val && position.first != row) {
-            return false;
-        }
+        text[length++] = '\n';
     }
+    text[length++] = '\n';
 
-    //check box
-    int box_x = position.first / 3;
-    int box_y = position.second / 3;
-
-    for(int row = box_x * 3; row < (box_x * 3) + 3; row++) {
-        for(int column = box_y * 3; column < (box_y * 3) + 3; column++){
-            
-            if( (curr_board[row][column] == val) && (row != position.first) && (column != position.second)){
-                return false;
-            }
-        }
-    } 
-    return true;
+    cout.write(text, length);
+    cout.flush();
 }
 
 
-/// @brief Returns the position of the first non-zero value in the puzzle.
-/// @param curr_board Takes in the current board as a 2D array.
-/// @return Returns the position of the first non-zero value in the puzzle.
-pair<int, int> Sudoku::valid_puzzle_helper(int curr_board[9][9]){
-    for(int row = 0; row < 9; row++){
-        for(int column = 0; column < 9; column++){
-            if(curr_board[row][column] > 0) {
-                return make_pair(row, column);
-            }
-        }
-    }
-    return make_pair(-1, -1);
-}
-
-
-/// @brief Calls the valid_puzzle_helper to get the position of a non-zero, calls valid_puzzle to check if the column, row, and
-///          box in that position follow the sudoku rule of non-repeated value. If its invalid, returns false and and if its valid
-///          it returns true and cames a recurisve call to puzzle_check. Recursive ends when all non-zero values are checked or 
-///          when the puzzle violates the rule.
-/// @param curr_board Takes in the current board as a 2D array.
-/// @param position akes in the position of the value as a pair to check if values are repeated
-/// @return True if valid, False if not
-bool Sudoku::puzzle_check(int curr_board[9][9], pair<int, int> position){
-
-    // Checks if non-zero value exists
-    if(valid_puzzle_helper(curr_board).first == -1){
-        return true;
-    }
-    else{
-
-        // Check if the column, row, and box in that position follow the sudoku rule of non-repeated value.
-        if(valid_puzzle(curr_board, valid_puzzle_helper(curr_board))){
-
-            // Set that position to 0.
-            curr_board[position.first][position.second] = 0;
-
-            // Recursive call to puzzle_check
-            if(puzzle_check(curr_board, valid_puzzle_helper(curr_board))){
-                return true;
-            }
-            else{
-                return false;
-            }
-            
-        }
-        // Return false if the column, row, and box in that position does not follow the sudoku rule of non-repeated value.
-        return false;
-    }
-}
+/*                                     Code for checking if the provided puzzle is valid                                         */
 
 
-/// @brief Creates a back up board to check if all the non-zero values are valid. Does this by calling puzzle check.
+/// @brief Checks the puzzle read by create_board in one bitmask pass over the cells (see check_board), and loads it
+///         into the board if it is valid. The cells holding a repeated number are kept in board_check.
 /// @return returns true if valid, false if not
 bool Sudoku::puzzle_ready(){
    
-    // Creates and populate the back_up 2D array
-    int back_up[9][9];
-    for(int row = 0; row < 9; row++){
-        for(int column = 0; column < 9; column ++){
-            back_up[row][column] = board[row][column];
-        }
-    }
-    
-    // Calls the puzzle_check function to see if puzzle is valid.
-    if(puzzle_check(back_up, valid_puzzle_helper(back_up))){
-        return true;
-    }
-    else{
-        return false;
-    }
-}
+    STAT_PHASE(validate_seconds);
 
-/*                                             Code for solving a sudoku puzzle                                                   */
-
-/// @brief Find an empty cell in the Sudoku board.
-///         This function searches through the provided curr_board to find the first empty cell (represented by the value 0).
-///         It iterates through each row and column, checking the value of each cell. If an empty cell is found, the row and column
-///         indices are returned as a pair. If no empty cell is found, the function returns (-1, -1) to indicate that the board is full.
-///
-/// @param curr_board The current state of the Sudoku board.
-/// @return A pair of integers representing the row and column indices of an empty cell, or (-1, -1) if no empty cell is found.
-pair<int, int> Sudoku::find_empty(int curr_board[9][9]) {
-    
-    for(int row = 0; row < 9; row++){
-        for(int column = 0; column < 9; column++){
-            if(curr_board[row][column] == 0) {
-                return make_pair(row, column); // Return the indices of the empty cell.
-            }
-        }
-    }
-    return make_pair(-1, -1); // Return (-1, -1) if no empty cell is found.
+    check_board(board_text, nullptr, board_check);
+    return board_check.valid() && board.parse(board_text);
 }
 
-/// @brief Check if placing a value in a certain position is a valid move in the Sudoku board.
-///         This function checks the validity of placing the given `val` in the specified `position` of the Sudoku board (`curr_board`).
-///         It performs three checks to ensure the placement is valid: it checks the row, column, and 3x3 box in which the position is located.
-///         If placing the value in the position violates any Sudoku rules (same value already exists in the row, column, or box),
-///         the function returns false. Otherwise, it returns true to indicate that the placement is valid.
-///
-/// @param curr_board The current state of the Sudoku board.
-/// @param val The value to be placed in the position.
-/// @param position The row and column indices of the position to check.
-/// @return True if placing the value in the position is a valid move, otherwise false.
-bool Sudoku::valid_solution(int curr_board[9][9], int val, pair<int, int> position){
-    
-    //check through each column in the row to see if the value exists more than once
-    for(int column = 0; column < 9; column++){
-        if( (curr_board[position.first][column] == val) &&  position.second != column) {
-            return false;
-        }
-    }
-
-    //check through each row in the column to see if the value exists more than once
-    for(int row = 0; row < 9; row++){
-        if( (curr_board[row][position.second]) == val && position.first != row) {
-            return false;
-        }
-    }
-
-    //check box
-    int box_x = position.first / 3;
-    int box_y = position.second / 3;
-
-    for(int row = box_x * 3; row < (box_x * 3) + 3; row++) {
-        for(int column = box_y * 3; column < (box_y * 3) + 3; column++){
-            
-            if( (curr_board[row][column] == val) && (row != position.first) && (column != position.second)){
-                return false;
-            }
-        }
-    } 
-    return true;
-}
-
-/// @brief Recursive helper function to solve the Sudoku puzzle.
-///         This function uses a backtracking algorithm to solve the Sudoku puzzle represented by the `curr_board`.
-///         It iterates through each empty cell of the board, and for each cell, it tries placing a value from 1 to 9.
-///         It calls the `valid_solution` function to determine if placing the value is valid according to Sudoku rules.
-///         If a valid value is found, it places the value and recursively calls itself to solve the remaining puzzle.
-///         If the puzzle is successfully solved, it returns true. If no valid value is found, or the puzzle
-///         cannot be solved, it backtracks by setting the cell value back to 0 and continues with other possibilities.
-///         If no solution is found after trying all possibilities, it returns false to indicate failure in solving.
-///
-/// @param curr_board The current state of the Sudoku board.
-/// @return True if the puzzle is solved successfully, otherwise false.
-bool Sudoku::solve_helper(int curr_board[9][9]) {
-    
-
-    if(find_empty(curr_board).first == -1){
-        return true; // Puzzle is solved when there are no more empty cells.
-    }
-    else{
-        int row = find_empty(curr_board).first;
-        int column = find_empty(curr_board).second;
-    
-        for(int val = 1; val < 10; val++){
-            
-            if(valid_solution(curr_board, val, find_empty(curr_board))){ // Checks if value is valid
-                curr_board[row][column] = val; // Place the valid value in the cell.
-                
-                if(solve_helper(curr_board)){
-                    return true; // Recursively solve the remaining puzzle.
-                }
-                else{
-                    curr_board[row][column] = 0; // Backtrack by resetting the cell value.
-                }
-            }
-        }
-        return false; // No valid value found for the current cell, backtrack further.
-    }
-}
+/*                                             Code for solving a sudoku puzzle                                                   */
 
-/// @brief Calls the solve_helper and passes in the board.
+/// @brief Solves the board in place with the bitmask `Grid` engine, which keeps the row, column and box occupancy as
+///         masks and backtracks over the legal candidates of the first empty cell in row-major order, trying 1 to 9 in
+///         order. If the puzzle cannot be solved, the board is left untouched.
 void Sudoku::solve(){
-    solve_helper(board);
+    STAT_PHASE(solve_seconds);
+    board.solve();
+    board.format(board_text);
 }
 
 
@@ -406,12 +243,8 @@ void Sudoku::solve(){
 ///         It uses the `fill_box` function to fill each individual 3x3 box of the diagonal.
 void Sudoku::fill_diagonal(){
 
-    // Populate all value to zero
-    for(int row = 0; row < 9; row++){
-        for(int column = 0; column < 9; column++){
-            board[row][column] = 0;
-        }
-    }
+    // Start from an empty board
+    board = Grid();
 
     // Populate the the diagonal boxes bay calling the fill_box function.
     for(int i = 0; i < 9; i += 3){
@@ -428,22 +261,16 @@ void Sudoku::fill_diagonal(){
 /// @param column The starting column index of the 3x3 box.
 void Sudoku::fill_box(int row, int column){
 
-    // Prepare a vector of values from 1 to 9 in random order.
-    vector<int> value;
-    for(int i = 1; i < 10; i++){
-        value.push_back(i);
-    }
-
-    random_device rd;
-    auto rng = default_random_engine(rd());
-    shuffle(value.begin(), value.end(), rng); 
+    // Prepare the values from 1 to 9 in random order.
+    int value[9] = {1, 2, 3, 4, 5, 6, 7, 8, 9};
+    rng.shuffle(value, 9);
 
     int value_index = 0;
 
     // Fill the 3x3 box with the shuffled values.
     for(int i = row; i < row + 3; i++){
         for(int j = column; j < column + 3; j++){
-            board[i][j] = value[value_index];
+            board.place(i * 9 + j, value[value_index]);
             value_index++;
         }
     }
@@ -451,82 +278,48 @@ void Sudoku::fill_box(int row, int column){
 
 /// @brief Remove cells from the Sudoku board to create a puzzle.
 ///         This function removes a specified number of cells from the Sudoku board to create a puzzle
-///         while ensuring that the resulting puzzle still has a unique solution. It iterates through the
-///         board and randomly removes cells, then checks if the puzzle remains unique by attempting to solve
-///         it with the removed cell. If the puzzle becomes non-unique, the removed cell is restored.
+///         while ensuring that the resulting puzzle still has a unique solution. It goes through the cells
+///         in a shuffled order, trying each one once: a cell is removed, then the puzzle is checked for a unique
+///         solution. If the puzzle becomes non-unique, the removed cell is restored and does not count, so exactly
+///         num_to_remove cells are removed unless every cell was tried first. The board is changed in place, a
+///         removal is undone by placing the digit back, no copy of the board is made.
 ///
 /// @param num_to_remove The number of cells to remove from the board.
 void Sudoku::remove_cell(int num_to_remove){
-    
-    while(num_to_remove > 0) {
-
-        // Generate random row and column indices.
-        int row = rand() % 9;
-        int column = rand() % 9;
 
-        if(board[row][column] != 0){
-            int temp = board[row][column];
-            board[row][column] = 0;
-
-            // Create a backup of the current board.
-            int backup_board[9][9];
+    // Visit the cells in a random order.
+    int order[81];
+    for(int cell = 0; cell < 81; cell++){
+        order[cell] = cell;
+    }
+    rng.shuffle(order, 81);
 
-            for(int i = 0; i < 9; i++){
-                for(int j = 0; j < 9; j++){
-                    backup_board[i][j] = board[i][j];
-                }
-            }
+    for(int i = 0; i < 81 && num_to_remove > 0; i++){
+        int cell = order[i];
+        int temp = board.get(cell);
+        board.unplace(cell);
 
-            // Check if removing the cell results in a non-unique solution.
-            if(!is_unique(backup_board)){
-                board[row][column] = temp; // Restore the removed cell.
-            }
-            else{
-                board[row][column] = 0; // Cell successfully removed.
-            }
+        // Check if removing the cell results in a non-unique solution.
+        if(is_unique(board)){
             num_to_remove--;
         }
+        else{
+            board.place(cell, temp); // Restore the removed cell.
+        }
     }
 }
 
 
 /// @brief Checks if a Sudoku puzzle has a unique solution.
-///         This function attempts to solve the given Sudoku puzzle and determines if it has a unique solution.
-///         It uses the `solve_helper` function to solve the puzzle and counts the number of solutions found.
-///         If more than one solution is found during the solving process, it returns false to indicate
-///         that the puzzle has multiple solutions. If only one solution is found, it returns true to indicate
-///         that the puzzle has a unique solution.
+///         This function counts the solutions of the given Sudoku puzzle with `count_solutions`, which stops as soon as
+///         a second solution is found. If more than one solution exists, it returns false to indicate that the puzzle
+///         has multiple solutions. If exactly one exists, it returns true to indicate that the puzzle has a unique solution.
 ///
-/// @param curr_board The current state of the Sudoku board.
-/// @return True if the puzzle has a unique solution, false if it has multiple solutions.
-bool Sudoku::is_unique(int curr_board[9][9]){
-
-    int solutions = 0;
-    solve_helper(curr_board);
-
-    // Continue solving to find additional solutions
-    while (find_empty(curr_board).first != -1) {
-
-        int row = find_empty(curr_board).first;
-        int column = find_empty(curr_board).second;
-    
-        for (int val = 1; val <= 9; val++) {
-            if (valid_solution(curr_board, val, make_pair(row, column))) {
-                curr_board[row][column] = val;
-                
-                if (solve_helper(curr_board)) {
-                    solutions++;
-                    if (solutions > 1) {
-                        return false; // Multiple solutions found
-                    }
-                }
-
-                curr_board[row][column] = 0;
-            }
-        }
-        
-    }
-    return true; // Unique solution found
+/// @param grid The current state of the Sudoku board.
+/// @return True if the puzzle has a unique solution, false if it has multiple solutions or none.
+bool Sudoku::is_unique(const Grid& grid){
+    STAT_ADD(uniqueness_checks, 1);
+    return count_solutions(grid, 2) == 1;
 }
 
 /// @brief Generates a Sudoku puzzle for the user to solve.
@@ -540,8 +333,10 @@ bool Sudoku::is_unique(int curr_board[9][9]){
 /// 5. Print the generated puzzle using the print_board function.
 void Sudoku::generate(){
 
+    STAT_PHASE(generate_seconds);
+
     // Determine the number of cells to remove from the solved puzzle
-    int num_to_remove = rand() % 20 + 30;
+    int num_to_remove = rng.below(20) + 30;
 
     // Step 1: Fill the diagonal boxes to create a valid partially-filled puzzle
     fill_diagonal();
@@ -553,6 +348,7 @@ void Sudoku::generate(){
     remove_cell(num_to_remove);
 
     // Step 4: Print the generated puzzle
+    board.format(board_text);
     print_board();
 }
 
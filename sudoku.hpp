@@ -2,6 +2,11 @@
 #define SUDOOKU_H
 #include <iostream>
 #include <utility>
+#include "count.hpp"
+#include "grid.hpp"
+#include "io.hpp"
+#include "rng.hpp"
+#include "validate.hpp"
 
 
 using namespace std;
@@ -13,33 +18,29 @@ class Sudoku{
         
     
     private:
-        void create_board(string text_file); // Function to read puzzle from a text file and initialize the board
+        void create_board(const MappedFile& File, string text_file); // Function to read puzzle from a text file and initialize the board
         void print_board(); // Function to print the current state of the Sudoku boar
 
         // Puzzle validation and solving helper functions
-        bool valid_puzzle(int curr_board[9][9], pair<int, int> position);
-        pair<int, int> valid_puzzle_helper(int curr_board[9][9]);
-        bool puzzle_check(int curr_board[9][9], pair<int, int> position);
         bool puzzle_ready();
         
 
-        pair<int, int> find_empty(int curr_board[9][9]); // Function to find an empty cell on the board
-        bool valid_solution(int curr_board[9][9], int val, pair<int, int> position); // Function to check if a value can be placed at a specific position
-        
-        // Recursive backtracking solver       
-        bool solve_helper(int curr_board[9][9]);
+        // Bitmask backtracking solver
         void solve();
 
         // Functions for generating Sudoku puzzles
         void fill_diagonal();
         void fill_box(int row, int column);
         void remove_cell(int num_to_remove);
-        bool is_unique(int curr_board[9][9]);
+        bool is_unique(const Grid& grid);
         void generate(); // Generates a Sudoku puzzle
                 
 
-        int board[9][9]; // The Sudoku puzzle board
+        Grid board; // The Sudoku puzzle board, digits and candidate masks
+        char board_text[81]; // The board as printed, '0' or '.' for blanks; the puzzle as read until puzzle_ready loads it
+        BoardCheck board_check; // Result of the last puzzle_ready, with the conflicting cells
         int option; // User option for puzzle creation or generation
+        Rng rng; // Random number generator used to generate puzzles
         
         
 };
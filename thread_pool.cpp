@@ -0,0 +1,136 @@
+#ifndef THREAD_POOL_CPP
+#define THREAD_POOL_CPP
+#include "thread_pool.hpp"
+
+static thread_local int worker_index = -1; // Set once in each worker thread
+
+/// @brief Constructor for the ThreadPool class, starts the workers.
+/// @param threads The number of worker threads, 0 uses std::thread::hardware_concurrency.
+ThreadPool::ThreadPool(unsigned threads) : queued(0), unfinished(0), stopping(false), next_queue(0){
+
+    if(threads == 0){
+        threads = thread::hardware_concurrency();
+    }
+    if(threads == 0){
+        threads = 1;
+    }
+
+    for(unsigned i = 0; i < threads; i++){
+        queues.push_back(make_unique<Queue>());
+    }
+    for(unsigned i = 0; i < threads; i++){
+        workers.emplace_back(&ThreadPool::worker, this, i);
+    }
+}
+
+/// @brief Destructor for the ThreadPool class, lets the queued tasks finish and then joins every worker.
+ThreadPool::~ThreadPool(){
+    wait();
+    {
+        lock_guard<mutex> guard(state_lock);
+        stopping = true;
+    }
+    work_ready.notify_all();
+
+    for(thread& t : workers){
+        t.join();
+    }
+}
+
+/// @brief Queues a task. From a worker thread the task goes on that worker's own deque so it stays hot in its cache.
+/// @param task The function to run.
+void ThreadPool::submit(function<void()> task){
+
+    int index = current_worker();
+    if(index < 0 || index >= (int)queues.size()){
+        index = next_queue.fetch_add(1, memory_order_relaxed) % queues.size();
+    }
+
+    {
+        lock_guard<mutex> guard(queues[index]->lock);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    {
+        lock_guard<mutex> guard(state_lock);
+        queued++;
+        unfinished++;
+    }
+    work_ready.notify_one();
+}
+
+/// @brief Blocks the caller until every task submitted so far, and every task those tasks submitted, has finished.
+void ThreadPool::wait(){
+    unique_lock<mutex> guard(state_lock);
+    all_done.wait(guard, [this] { return unfinished == 0; });
+}
+
+/// @brief Returns the index of the worker running the calling thread.
+/// @return The worker index, or -1 if the caller is not a pool worker.
+int ThreadPool::current_worker(){
+    return worker_index;
+}
+
+/// @brief Takes a task for a worker, first from the back of its own deque and then from the front of the others.
+/// @param index The worker index.
+/// @param task Receives the task.
+/// @return True if a task was found.
+bool ThreadPool::pop(unsigned index, function<void()>& task){
+
+    {
+        Queue& own = *queues[index];
+        lock_guard<mutex> guard(own.lock);
+        if(!own.tasks.empty()){
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+
+    for(unsigned i = 1; i < queues.size(); i++){
+        Queue& victim = *queues[(index + i) % queues.size()];
+        lock_guard<mutex> guard(victim.lock);
+        if(!victim.tasks.empty()){
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+/// @brief Main loop of a worker thread. Sleeps while there is nothing queued anywhere.
+/// @param index The worker index.
+void ThreadPool::worker(unsigned index){
+
+    worker_index = index;
+
+    while(true){
+        {
+            unique_lock<mutex> guard(state_lock);
+            work_ready.wait(guard, [this] { return stopping || queued > 0; });
+            if(queued == 0){
+                return; // Stopping and nothing left to do.
+            }
+            queued--; // Reserve one of the queued tasks for this worker.
+        }
+
+        // Every reservation is backed by a task in some deque, so this only spins while another worker holds a lock.
+        function<void()> task;
+        while(!pop(index, task)){
+            this_thread::yield();
+        }
+
+        task();
+
+        bool last;
+        {
+            lock_guard<mutex> guard(state_lock);
+            last = (--unfinished == 0);
+        }
+        if(last){
+            all_done.notify_all();
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/// @brief Work-stealing thread pool.
+///         Every worker owns a deque. A worker takes its newest task from the back of its own deque and, when it runs
+///         dry, steals the oldest task from the front of another worker's deque. Tasks submitted from inside a worker go
+///         to that worker's deque, tasks submitted from outside are spread round-robin.
+class ThreadPool{
+    public:
+
+        explicit ThreadPool(unsigned threads = 0); // Constructor, 0 uses one thread per core
+        ~ThreadPool(); // Waits for queued tasks and joins the workers
+
+        void submit(function<void()> task); // Queues a task
+        void wait(); // Blocks until every submitted task has finished
+        unsigned size() const { return workers.size(); }
+
+        static int current_worker(); // Index of the calling worker, -1 when called from outside the pool
+
+    private:
+        struct Queue{
+            mutex lock;
+            deque<function<void()>> tasks;
+        };
+
+        void worker(unsigned index);
+        bool pop(unsigned index, function<void()>& task);
+
+        vector<unique_ptr<Queue>> queues;
+        vector<thread> workers;
+
+        mutex state_lock;
+        condition_variable work_ready; // Signalled when a task is queued or the pool stops
+        condition_variable all_done; // Signalled when unfinished drops to zero
+        size_t queued; // Tasks in a deque not yet claimed by a worker, guarded by state_lock
+        size_t unfinished; // Tasks queued or running, guarded by state_lock
+        bool stopping;
+        atomic<unsigned> next_queue;
+};
+
+#endif
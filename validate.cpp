@@ -0,0 +1,617 @@
+#ifndef VALIDATE_CPP
+#define VALIDATE_CPP
+#include "validate.hpp"
+#include "grid.hpp"
+#include "io.hpp"
+#include "thread_pool.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <immintrin.h>
+#include <iostream>
+#include <vector>
+
+static const size_t VALIDATE_WINDOW = 1 << 16; // Boards read, checked and written per round
+static const size_t VALIDATE_CHUNK = 4096; // Boards per pool task, a check costs a few nanoseconds
+
+/*                                                 Scalar check                                                                  */
+
+static const uint16_t NOT_A_DIGIT = 0x8000; // Marks a character that is neither a digit nor a blank
+
+/// @brief Digit bit of every character: bit (d - 1) for '1'-'9', 0 for the blanks '.' and '0', NOT_A_DIGIT otherwise.
+struct CharacterBits{
+    uint16_t bits[256];
+
+    constexpr CharacterBits() : bits(){
+        for(int c = 0; c < 256; c++){
+            bits[c] = (c >= '1' && c <= '9') ? (uint16_t)(1 << (c - '1')) : (c == '.' || c == '0') ? 0 : NOT_A_DIGIT;
+        }
+    }
+};
+
+static constexpr CharacterBits CHARACTER_BITS{};
+
+static inline uint16_t character_bit(char c){
+    return CHARACTER_BITS.bits[(unsigned char)c];
+}
+
+/// @brief One pass over a board in row order: the digit bit of every cell is tested against the digits already seen in
+///         its row, column and box with a single AND, and compared with the given of its cell.
+/// @return The result bits.
+static uint8_t scan_board(const char* board, const char* clues){
+
+    uint16_t columns[9] = {};
+    uint16_t boxes[9] = {};
+    uint16_t repeated = 0;
+    uint16_t marks = 0; // OR of every character bit, to spot the malformed ones
+    uint16_t altered = 0;
+    bool blank = false;
+
+    for(int row = 0; row < 9; row++){
+        uint16_t seen = 0;
+        for(int column = 0; column < 9; column++){
+            uint16_t raw = character_bit(board[row * 9 + column]);
+            uint16_t bit = raw & Grid::ALL;
+            uint16_t& box = boxes[row / 3 * 3 + column / 3];
+
+            repeated |= (seen | columns[column] | box) & bit;
+            seen |= bit;
+            columns[column] |= bit;
+            box |= bit;
+            marks |= raw;
+            blank |= raw == 0;
+
+            if(clues != nullptr){
+                uint16_t given = character_bit(clues[row * 9 + column]);
+                marks |= given;
+                altered |= (given & Grid::ALL) != 0 && given != bit;
+            }
+        }
+    }
+
+    return ((marks & NOT_A_DIGIT) ? CHECK_MALFORMED : 0) | (repeated ? CHECK_CONFLICT : 0) |
+           (altered ? CHECK_ALTERED : 0) | (blank ? CHECK_INCOMPLETE : 0);
+}
+
+/// @brief Checks one board against the Sudoku rules and, if given, against the puzzle it was solved from.
+/// @param board 81 characters, '1'-'9' for digits, '.' or '0' for blanks.
+/// @param clues The 81 characters of the original puzzle, or nullptr to only check the rules.
+/// @return The result bits, 0 for a complete and correct solution.
+uint8_t check_flags(const char* board, const char* clues){
+    return scan_board(board, clues);
+}
+
+/// @brief Checks one board and locates the faults. The cells are only located when the first pass finds a fault, so a
+///         correct board costs a single pass.
+/// @param board 81 characters, '1'-'9' for digits, '.' or '0' for blanks.
+/// @param clues The 81 characters of the original puzzle, or nullptr to only check the rules.
+/// @param check Receives the result bits, the conflicting cells (every copy of a repeated digit) and the altered givens.
+void check_board(const char* board, const char* clues, BoardCheck& check){
+
+    check = BoardCheck();
+    check.flags = scan_board(board, clues);
+    if((check.flags & (CHECK_CONFLICT | CHECK_ALTERED)) == 0){
+        return;
+    }
+
+    // Digits repeated in every unit, then the cells holding one of the repeated digits of their units.
+    uint16_t seen[27] = {};
+    uint16_t dup[27] = {};
+    for(int cell = 0; cell < 81; cell++){
+        uint16_t bit = character_bit(board[cell]) & Grid::ALL;
+        for(int unit : {row_of(cell), 9 + column_of(cell), 18 + box_of(cell)}){
+            dup[unit] |= seen[unit] & bit;
+            seen[unit] |= bit;
+        }
+    }
+
+    for(int cell = 0; cell < 81; cell++){
+        uint16_t bit = character_bit(board[cell]) & Grid::ALL;
+        uint64_t cell_bit = uint64_t(1) << (cell & 63);
+
+        if((dup[row_of(cell)] | dup[9 + column_of(cell)] | dup[18 + box_of(cell)]) & bit){
+            check.conflicts[cell >> 6] |= cell_bit;
+        }
+        if(clues != nullptr){
+            uint16_t given = character_bit(clues[cell]) & Grid::ALL;
+            if(given != 0 && given != bit){
+                check.altered[cell >> 6] |= cell_bit;
+            }
+        }
+    }
+}
+
+/*                                                 Vector kernels                                                                */
+
+// A kernel writes the result bits of count boards. The vector kernels check several boards in lockstep, one board per
+// lane, and leave the boards that do not fill a whole vector to the scalar check.
+struct ValidationKernel{
+    const char* name;
+    void (*check)(const char* const* boards, const char* const* clues, size_t count, uint8_t* flags);
+};
+
+static void check_scalar(const char* const* boards, const char* const* clues, size_t count, uint8_t* flags){
+    for(size_t i = 0; i < count; i++){
+        flags[i] = scan_board(boards[i], clues ? clues[i] : nullptr);
+    }
+}
+
+/// @brief Loads the 4 bytes at offset of 8 lines into the 8 lanes. The lines can be anywhere in memory, the gathers use
+///         their 64-bit distances from the first one.
+__attribute__((target("avx2")))
+static inline __m256i gather_lines(const char* base, __m256i low, __m256i high, int offset){
+    __m128i first = _mm256_i64gather_epi32((const int*)(base + offset), low, 1);
+    __m128i second = _mm256_i64gather_epi32((const int*)(base + offset), high, 1);
+    return _mm256_set_m128i(second, first);
+}
+
+/// @brief Gathers the 81 characters of 8 lines, 4 per lane and word. Word 20 is read from offset 77 so nothing past the
+///         end of a line is touched, its last character is the top byte.
+__attribute__((target("avx2")))
+static inline void gather_board(const char* const* lines, __m256i words[21]){
+    const char* base = lines[0];
+    __m256i low = _mm256_setr_epi64x(0, lines[1] - base, lines[2] - base, lines[3] - base);
+    __m256i high = _mm256_setr_epi64x(lines[4] - base, lines[5] - base, lines[6] - base, lines[7] - base);
+    for(int word = 0; word < 20; word++){
+        words[word] = gather_lines(base, low, high, 4 * word);
+    }
+    words[20] = _mm256_srli_epi32(gather_lines(base, low, high, 77), 24);
+}
+
+/// @brief Character of a cell in every lane of the gathered words.
+__attribute__((target("avx2"), always_inline))
+static inline __m256i lane_character(const __m256i words[21], int cell){
+    __m256i word = cell == 80 ? words[20] : words[cell / 4];
+    switch(cell % 4){
+        case 1: word = _mm256_srli_epi32(word, 8); break;
+        case 2: word = _mm256_srli_epi32(word, 16); break;
+        case 3: word = _mm256_srli_epi32(word, 24); break;
+    }
+    return _mm256_and_si256(word, _mm256_set1_epi32(0xFF));
+}
+
+/// @brief Digit bit of every lane, 0 for a blank or a malformed character. '1' shifts by 0; the blanks and everything
+///         below '1' give negative counts, which clear the bit like the counts past 31.
+__attribute__((target("avx2"), always_inline))
+static inline __m256i lane_bit(__m256i characters){
+    __m256i bit = _mm256_sllv_epi32(_mm256_set1_epi32(1), _mm256_sub_epi32(characters, _mm256_set1_epi32('1')));
+    return _mm256_and_si256(bit, _mm256_set1_epi32(Grid::ALL));
+}
+
+/// @brief Lanes holding a blank character, '.' or '0'.
+__attribute__((target("avx2"), always_inline))
+static inline __m256i lane_blank(__m256i characters){
+    return _mm256_or_si256(_mm256_cmpeq_epi32(characters, _mm256_set1_epi32('.')),
+                           _mm256_cmpeq_epi32(characters, _mm256_set1_epi32('0')));
+}
+
+/// @brief Result bits of 8 boards, one per lane, with the same row-order pass as scan_board. The loops are unrolled so
+///         the unit of every cell and the byte it sits in are constants.
+__attribute__((target("avx2")))
+static void check_eight_avx2(const char* const* boards, const char* const* clues, uint8_t* flags){
+
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i words[21];
+    __m256i clue_words[21];
+    gather_board(boards, words);
+    if(clues){
+        gather_board(clues, clue_words);
+    }
+
+    __m256i columns[9];
+    __m256i boxes[3];
+    __m256i repeated = zero;
+    __m256i malformed = zero;
+    __m256i blank = zero;
+    __m256i altered = zero;
+    for(int column = 0; column < 9; column++){
+        columns[column] = zero;
+    }
+
+    #pragma GCC unroll 9
+    for(int row = 0; row < 9; row++){
+        if(row % 3 == 0){
+            boxes[0] = boxes[1] = boxes[2] = zero;
+        }
+        __m256i seen = zero;
+
+        #pragma GCC unroll 9
+        for(int column = 0; column < 9; column++){
+            int cell = row * 9 + column;
+            __m256i characters = lane_character(words, cell);
+            __m256i bit = lane_bit(characters);
+            __m256i is_blank = lane_blank(characters);
+            __m256i& box = boxes[column / 3];
+
+            __m256i units = _mm256_or_si256(_mm256_or_si256(seen, columns[column]), box);
+            repeated = _mm256_or_si256(repeated, _mm256_and_si256(units, bit));
+            seen = _mm256_or_si256(seen, bit);
+            columns[column] = _mm256_or_si256(columns[column], bit);
+            box = _mm256_or_si256(box, bit);
+            blank = _mm256_or_si256(blank, is_blank);
+            malformed = _mm256_or_si256(malformed, _mm256_andnot_si256(is_blank, _mm256_cmpeq_epi32(bit, zero)));
+
+            if(clues){
+                __m256i clue_characters = lane_character(clue_words, cell);
+                __m256i given = lane_bit(clue_characters);
+                __m256i no_given = _mm256_cmpeq_epi32(given, zero);
+                malformed = _mm256_or_si256(malformed, _mm256_andnot_si256(lane_blank(clue_characters), no_given));
+                altered = _mm256_or_si256(altered, _mm256_andnot_si256(no_given, _mm256_xor_si256(given, bit)));
+            }
+        }
+    }
+
+    int malformed_lanes = _mm256_movemask_ps(_mm256_castsi256_ps(malformed));
+    int conflict_lanes = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(repeated, zero)));
+    int altered_lanes = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(altered, zero)));
+    int blank_lanes = _mm256_movemask_ps(_mm256_castsi256_ps(blank));
+
+    for(int lane = 0; lane < 8; lane++){
+        flags[lane] = ((malformed_lanes >> lane & 1) ? CHECK_MALFORMED : 0) |
+                      ((conflict_lanes >> lane & 1) ? CHECK_CONFLICT : 0) |
+                      ((altered_lanes >> lane & 1) ? CHECK_ALTERED : 0) |
+                      ((blank_lanes >> lane & 1) ? CHECK_INCOMPLETE : 0);
+    }
+}
+
+__attribute__((target("avx2")))
+static void check_avx2(const char* const* boards, const char* const* clues, size_t count, uint8_t* flags){
+    size_t i = 0;
+    for(; i + 8 <= count; i += 8){
+        check_eight_avx2(boards + i, clues ? clues + i : nullptr, flags + i);
+    }
+    check_scalar(boards + i, clues ? clues + i : nullptr, count - i, flags + i);
+}
+
+// The unmasked forms of a few AVX-512 intrinsics start from an undefined vector, which -Wall reports as uninitialized
+// with some GCC versions; the zero-masked forms with every lane selected compile to the same instructions.
+static const __mmask16 ALL_LANES = 0xFFFF;
+
+/// @brief Gathers the 81 characters of 16 lines, like gather_board.
+__attribute__((target("avx512f")))
+static inline void gather_board_512(const char* const* lines, __m512i words[21]){
+    const char* base = lines[0];
+    __m512i low = _mm512_setr_epi64(0, lines[1] - base, lines[2] - base, lines[3] - base,
+                                    lines[4] - base, lines[5] - base, lines[6] - base, lines[7] - base);
+    __m512i high = _mm512_setr_epi64(lines[8] - base, lines[9] - base, lines[10] - base, lines[11] - base,
+                                     lines[12] - base, lines[13] - base, lines[14] - base, lines[15] - base);
+    for(int word = 0; word < 21; word++){
+        const char* at = base + (word == 20 ? 77 : 4 * word);
+        __m256i first = _mm512_mask_i64gather_epi32(_mm256_setzero_si256(), 0xFF, low, at, 1);
+        __m256i second = _mm512_mask_i64gather_epi32(_mm256_setzero_si256(), 0xFF, high, at, 1);
+        __m512i low_half = _mm512_maskz_inserti64x4(0xFF, _mm512_setzero_si512(), first, 0);
+        words[word] = _mm512_maskz_inserti64x4(0xFF, low_half, second, 1);
+    }
+    words[20] = _mm512_maskz_srli_epi32(ALL_LANES, words[20], 24);
+}
+
+/// @brief Character of a cell in every lane of the gathered words.
+__attribute__((target("avx512f"), always_inline))
+static inline __m512i lane_character_512(const __m512i words[21], int cell){
+    __m512i word = cell == 80 ? words[20] : words[cell / 4];
+    switch(cell % 4){
+        case 1: word = _mm512_maskz_srli_epi32(ALL_LANES, word, 8); break;
+        case 2: word = _mm512_maskz_srli_epi32(ALL_LANES, word, 16); break;
+        case 3: word = _mm512_maskz_srli_epi32(ALL_LANES, word, 24); break;
+    }
+    return _mm512_and_si512(word, _mm512_set1_epi32(0xFF));
+}
+
+/// @brief Digit bit of every lane and the lanes holding a blank, as in lane_bit and lane_blank.
+__attribute__((target("avx512f"), always_inline))
+static inline __m512i lane_bit_512(__m512i characters, __mmask16& is_blank){
+    is_blank = _mm512_cmpeq_epi32_mask(characters, _mm512_set1_epi32('.')) |
+               _mm512_cmpeq_epi32_mask(characters, _mm512_set1_epi32('0'));
+    __m512i shift = _mm512_sub_epi32(characters, _mm512_set1_epi32('1'));
+    __m512i bit = _mm512_maskz_sllv_epi32(ALL_LANES, _mm512_set1_epi32(1), shift);
+    return _mm512_and_si512(bit, _mm512_set1_epi32(Grid::ALL));
+}
+
+/// @brief Result bits of 16 boards, the AVX-512 version of check_eight_avx2 with the lane tests in mask registers.
+__attribute__((target("avx512f")))
+static void check_sixteen_avx512(const char* const* boards, const char* const* clues, uint8_t* flags){
+
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i words[21];
+    __m512i clue_words[21];
+    gather_board_512(boards, words);
+    if(clues){
+        gather_board_512(clues, clue_words);
+    }
+
+    __m512i columns[9];
+    __m512i boxes[3];
+    __m512i repeated = zero;
+    __m512i altered = zero;
+    __mmask16 malformed = 0;
+    __mmask16 blank = 0;
+    for(int column = 0; column < 9; column++){
+        columns[column] = zero;
+    }
+
+    #pragma GCC unroll 9
+    for(int row = 0; row < 9; row++){
+        if(row % 3 == 0){
+            boxes[0] = boxes[1] = boxes[2] = zero;
+        }
+        __m512i seen = zero;
+
+        #pragma GCC unroll 9
+        for(int column = 0; column < 9; column++){
+            int cell = row * 9 + column;
+            __mmask16 is_blank;
+            __m512i bit = lane_bit_512(lane_character_512(words, cell), is_blank);
+            __m512i& box = boxes[column / 3];
+
+            __m512i units = _mm512_or_si512(_mm512_or_si512(seen, columns[column]), box);
+            repeated = _mm512_or_si512(repeated, _mm512_and_si512(units, bit));
+            seen = _mm512_or_si512(seen, bit);
+            columns[column] = _mm512_or_si512(columns[column], bit);
+            box = _mm512_or_si512(box, bit);
+            blank |= is_blank;
+            malformed |= _mm512_cmpeq_epi32_mask(bit, zero) & ~is_blank;
+
+            if(clues){
+                __mmask16 no_clue;
+                __m512i given = lane_bit_512(lane_character_512(clue_words, cell), no_clue);
+                __mmask16 has_given = _mm512_test_epi32_mask(given, given);
+                malformed |= ~has_given & ~no_clue;
+                altered = _mm512_or_si512(altered, _mm512_maskz_xor_epi32(has_given, given, bit));
+            }
+        }
+    }
+
+    __mmask16 conflict = _mm512_test_epi32_mask(repeated, repeated);
+    __mmask16 changed = _mm512_test_epi32_mask(altered, altered);
+
+    for(int lane = 0; lane < 16; lane++){
+        flags[lane] = ((malformed >> lane & 1) ? CHECK_MALFORMED : 0) |
+                      ((conflict >> lane & 1) ? CHECK_CONFLICT : 0) |
+                      ((changed >> lane & 1) ? CHECK_ALTERED : 0) |
+                      ((blank >> lane & 1) ? CHECK_INCOMPLETE : 0);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void check_avx512(const char* const* boards, const char* const* clues, size_t count, uint8_t* flags){
+    size_t i = 0;
+    for(; i + 16 <= count; i += 16){
+        check_sixteen_avx512(boards + i, clues ? clues + i : nullptr, flags + i);
+    }
+    check_avx2(boards + i, clues ? clues + i : nullptr, count - i, flags + i);
+}
+
+static const ValidationKernel SCALAR_VALIDATION = {"scalar", check_scalar};
+static const ValidationKernel AVX2_VALIDATION = {"avx2", check_avx2};
+static const ValidationKernel AVX512_VALIDATION = {"avx512", check_avx512};
+
+/// @brief Picks the widest kernel the CPU supports.
+static const ValidationKernel* detect_validation_kernel(){
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f")){
+        return &AVX512_VALIDATION;
+    }
+    if(__builtin_cpu_supports("avx2")){
+        return &AVX2_VALIDATION;
+    }
+    return &SCALAR_VALIDATION;
+}
+
+static const ValidationKernel* validation = detect_validation_kernel();
+
+/// @brief Result bits of many boards, with the kernel in use.
+/// @param boards The boards, each 81 readable characters.
+/// @param clues The original puzzle of every board, or nullptr to only check the rules.
+/// @param count Number of boards.
+/// @param flags Receives the result bits of every board.
+void check_boards(const char* const* boards, const char* const* clues, size_t count, uint8_t* flags){
+    validation->check(boards, clues, count, flags);
+}
+
+/// @brief Returns the name of the validation kernel in use.
+const char* validation_kernel(){
+    return validation->name;
+}
+
+/// @brief Forces a validation kernel, used to compare them on the same input. Not meant to be called while boards are
+///         being checked.
+/// @param name "avx512", "avx2", "scalar", or "auto" for the widest supported one.
+/// @return True if the kernel exists and this CPU supports it.
+bool select_validation_kernel(const string& name){
+    if(name == "auto"){
+        validation = detect_validation_kernel();
+    }
+    else if(name == "scalar"){
+        validation = &SCALAR_VALIDATION;
+    }
+    else if(name == "avx2" && __builtin_cpu_supports("avx2")){
+        validation = &AVX2_VALIDATION;
+    }
+    else if(name == "avx512" && __builtin_cpu_supports("avx512f")){
+        validation = &AVX512_VALIDATION;
+    }
+    else{
+        return false;
+    }
+    return true;
+}
+
+/*                                                 Batch validation                                                              */
+
+/// @brief Appends the cells of a bitset as r<row>c<column>, separated by commas.
+static void append_cells(vector<char>& out, const uint64_t cells[2]){
+    bool first = true;
+    for(int cell = 0; cell < 81; cell++){
+        if(cells[cell >> 6] >> (cell & 63) & 1){
+            if(!first){
+                out.push_back(',');
+            }
+            const char name[4] = {'r', char('1' + row_of(cell)), 'c', char('1' + column_of(cell))};
+            out.insert(out.end(), name, name + 4);
+            first = false;
+        }
+    }
+}
+
+/// @brief Appends the verdict line of a board: solved, valid (correct so far, with blanks), malformed, or invalid with
+///         the conflicting cells and the altered givens.
+void append_verdict(vector<char>& out, uint8_t flags, const char* board, const char* clues){
+    static const string SOLVED = "solved\n";
+    static const string VALID = "valid\n";
+    static const string MALFORMED = "malformed\n";
+    static const string INVALID = "invalid";
+
+    const string& word = (flags & CHECK_MALFORMED) ? MALFORMED : (flags & CHECK_FAULTS) ? INVALID :
+                         (flags & CHECK_INCOMPLETE) ? VALID : SOLVED;
+    out.insert(out.end(), word.begin(), word.end());
+    if(&word != &INVALID){
+        return;
+    }
+
+    BoardCheck check;
+    check_board(board, clues, check);
+    if(check.flags & CHECK_CONFLICT){
+        static const string CONFLICTS = " conflicts=";
+        out.insert(out.end(), CONFLICTS.begin(), CONFLICTS.end());
+        append_cells(out, check.conflicts);
+    }
+    if(check.flags & CHECK_ALTERED){
+        static const string ALTERED = " altered=";
+        out.insert(out.end(), ALTERED.begin(), ALTERED.end());
+        append_cells(out, check.altered);
+    }
+    out.push_back('\n');
+}
+
+/// @brief One window of boards: the pointers to their lines in the mapped inputs, and the verdicts of every chunk.
+struct ValidateWindow{
+    vector<const char*> boards;
+    vector<const char*> clues;
+    vector<uint8_t> flags;
+    vector<vector<char>> out; // Verdict lines per chunk
+    vector<ValidateResult> totals; // Counts per chunk
+};
+
+/// @brief Checks every board of a file on the thread pool, optionally against the puzzle of every board from a second
+///         file read in lockstep. Both files are memory mapped and processed in windows like solve_batch: the pool checks
+///         one window with the vector kernel while the main thread writes the verdicts of the previous one.
+/// @param options The input, clue and output files and the number of threads.
+/// @return The counts of every verdict and the time it took.
+ValidateResult validate_batch(const ValidateOptions& options){
+
+    MappedFile input;
+    MappedFile clue_input;
+    BufferedWriter output;
+
+    // Handle invalid text files
+    if(!input.open(options.input)){
+        cerr << "ERROR: Failed to open " << options.input << ", check if file exists and try again." << endl;
+        exit(EXIT_FAILURE);
+    }
+    bool has_clues = !options.clues.empty();
+    if(has_clues && !clue_input.open(options.clues)){
+        cerr << "ERROR: Failed to open " << options.clues << ", check if file exists and try again." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(!output.open(options.output)){
+        cerr << "ERROR: Failed to open " << options.output << " for writing." << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    LineScanner scanner(input.data(), input.size());
+    LineScanner clue_scanner(clue_input.data(), clue_input.size());
+    ValidateResult result;
+
+    ValidateWindow windows[2];
+    for(ValidateWindow& window : windows){
+        window.boards.reserve(VALIDATE_WINDOW);
+        window.clues.reserve(has_clues ? VALIDATE_WINDOW : 0);
+        window.flags.resize(VALIDATE_WINDOW);
+    }
+
+    auto start = chrono::steady_clock::now();
+    {
+        ThreadPool pool(options.threads);
+
+        ValidateWindow* checking = &windows[0];
+        ValidateWindow* writing = nullptr;
+
+        while(true){
+            ValidateWindow& window = *checking;
+
+            // Collect the next window of boards, and their clues line for line.
+            window.boards.clear();
+            window.clues.clear();
+            for(const char* line; window.boards.size() < VALIDATE_WINDOW && (line = scanner.next()) != nullptr;){
+                window.boards.push_back(line);
+                if(has_clues){
+                    const char* clue = clue_scanner.next();
+                    if(clue == nullptr){
+                        cerr << "ERROR: " << options.clues << " has fewer puzzles than " << options.input
+                             << " has boards." << endl;
+                        exit(EXIT_FAILURE);
+                    }
+                    window.clues.push_back(clue);
+                }
+            }
+            result.boards += window.boards.size();
+
+            size_t chunks = (window.boards.size() + VALIDATE_CHUNK - 1) / VALIDATE_CHUNK;
+            window.out.resize(max(window.out.size(), chunks));
+            window.totals.assign(chunks, ValidateResult());
+
+            for(size_t chunk = 0; chunk < chunks; chunk++){
+                pool.submit([&window, has_clues, chunk] {
+                    size_t first = chunk * VALIDATE_CHUNK;
+                    size_t count = min(VALIDATE_CHUNK, window.boards.size() - first);
+                    const char* const* boards = &window.boards[first];
+                    const char* const* clues = has_clues ? &window.clues[first] : nullptr;
+                    uint8_t* flags = &window.flags[first];
+                    vector<char>& out = window.out[chunk];
+                    ValidateResult& totals = window.totals[chunk];
+
+                    check_boards(boards, clues, count, flags);
+
+                    out.clear();
+                    for(size_t i = 0; i < count; i++){
+                        append_verdict(out, flags[i], boards[i], clues ? clues[i] : nullptr);
+                        totals.malformed += (flags[i] & CHECK_MALFORMED) != 0;
+                        totals.invalid += (flags[i] & CHECK_MALFORMED) == 0 && (flags[i] & CHECK_FAULTS) != 0;
+                        totals.valid += flags[i] == CHECK_INCOMPLETE;
+                        totals.solved += flags[i] == 0;
+                    }
+                });
+            }
+
+            // Write the previous window while this one is checked.
+            if(writing != nullptr){
+                for(size_t chunk = 0; chunk < writing->totals.size(); chunk++){
+                    output.write(writing->out[chunk].data(), writing->out[chunk].size());
+                }
+            }
+
+            pool.wait();
+
+            for(const ValidateResult& totals : window.totals){
+                result.solved += totals.solved;
+                result.valid += totals.valid;
+                result.invalid += totals.invalid;
+                result.malformed += totals.malformed;
+            }
+
+            if(window.boards.empty()){
+                break;
+            }
+            writing = checking;
+            checking = (checking == &windows[0]) ? &windows[1] : &windows[0];
+        }
+    }
+
+    if(!output.close()){
+        cerr << "ERROR: Failed to write the results." << endl;
+        exit(EXIT_FAILURE);
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+#endif
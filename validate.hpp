@@ -0,0 +1,62 @@
+#ifndef VALIDATE_H
+#define VALIDATE_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Result bits of a board check. A board with none of them set is a complete, correct solution.
+enum : uint8_t{
+    CHECK_MALFORMED = 1, // A character is neither a digit nor a blank ('.' or '0'), in the board or its clues
+    CHECK_CONFLICT = 2, // A digit repeats in a row, column or box
+    CHECK_ALTERED = 4, // A given of the clues was changed or erased
+    CHECK_INCOMPLETE = 8, // Some cells are still blank
+    CHECK_FAULTS = CHECK_MALFORMED | CHECK_CONFLICT | CHECK_ALTERED
+};
+
+/// @brief Outcome of checking one 9x9 board, with the cells at fault as two-word bitsets indexed by cell.
+struct BoardCheck{
+    uint8_t flags = 0;
+    uint64_t conflicts[2] = {0, 0}; // Cells holding a digit that repeats in their row, column or box
+    uint64_t altered[2] = {0, 0}; // Given cells whose digit differs in the board
+
+    bool valid() const { return (flags & CHECK_FAULTS) == 0; } // No rule broken, blanks allowed
+    bool solved() const { return flags == 0; }
+};
+
+uint8_t check_flags(const char* board, const char* clues); // Result bits of one board, clues may be nullptr
+void check_board(const char* board, const char* clues, BoardCheck& check); // Result bits and the cells at fault
+
+/// @brief Result bits of many boards at once, 16 boards per step with AVX-512 and 8 with AVX2. clues is nullptr or
+///         holds one clue line per board. Every pointer must reach 81 readable characters.
+void check_boards(const char* const* boards, const char* const* clues, size_t count, uint8_t* flags);
+
+// Appends the verdict line of a board with its result bits, as written by validate_batch
+void append_verdict(vector<char>& out, uint8_t flags, const char* board, const char* clues);
+
+const char* validation_kernel(); // Name of the kernel in use: "avx512", "avx2" or "scalar"
+bool select_validation_kernel(const string& name); // Forces a kernel, false if unknown or not supported here
+
+/// @brief Settings for a validation run.
+struct ValidateOptions{
+    string input; // File with one submitted board per line, 81 characters
+    string clues; // File with the original puzzle of every board, line for line, empty to only check the rules
+    string output; // File the verdicts are written to, empty for standard output
+    unsigned threads = 0; // Worker threads, 0 for one per core
+};
+
+/// @brief Totals reported after a validation run.
+struct ValidateResult{
+    size_t boards = 0;
+    size_t solved = 0; // Complete and correct
+    size_t valid = 0; // Correct so far, with blanks left
+    size_t invalid = 0; // Conflicting or altered
+    size_t malformed = 0;
+    double seconds = 0;
+};
+
+ValidateResult validate_batch(const ValidateOptions& options); // Checks every board of the input file in order
+
+#endif
@@ -0,0 +1,638 @@
+#ifndef VARIANT_CPP
+#define VARIANT_CPP
+#include "variant.hpp"
+#include "budget.hpp"
+#include "io.hpp"
+#include "stats.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <string_view>
+
+static const size_t VARIANT_WINDOW = 1 << 14; // Puzzles read, solved and written per round
+static const size_t VARIANT_CHUNK = 64; // Puzzles per pool task
+
+/*                                                     Rules                                                                     */
+
+/// @brief Constructor for the VariantRules class, classic rules: the 3x3 boxes as regions and nothing else.
+VariantRules::VariantRules(){
+    for(int cell = 0; cell < 81; cell++){
+        regions[cell] = box_of<3>(cell);
+    }
+}
+
+/// @brief Tells if a character separates two rule tokens.
+static bool rule_separator(char c){
+    return c == ' ' || c == '\t' || c == ',' || c == '\r';
+}
+
+/// @brief Reads the cages of a killer token: one character per cell, then ':' and the sums separated by '/'.
+/// @return False if the layout, the number of sums or a sum cannot be read.
+static bool parse_cages(string_view value, VariantRules& rules){
+
+    if(value.size() < 82 || value[81] != ':'){
+        return false;
+    }
+
+    // Cages in the order their letter first appears.
+    int cage_of[128];
+    fill(cage_of, cage_of + 128, -1);
+    size_t first = rules.cages.size();
+    for(int cell = 0; cell < 81; cell++){
+        unsigned char letter = value[cell];
+        if(letter == '.' || letter >= 128){
+            if(letter != '.'){
+                return false;
+            }
+            continue;
+        }
+        if(cage_of[letter] == -1){
+            cage_of[letter] = (int)rules.cages.size();
+            rules.cages.emplace_back();
+        }
+        rules.cages[cage_of[letter]].cells.push_back(cell);
+    }
+
+    // One sum per cage, separated by '/'.
+    size_t position = 82;
+    for(size_t cage = first; cage < rules.cages.size(); cage++){
+        int sum = 0;
+        size_t digits = 0;
+        for(; position < value.size() && value[position] >= '0' && value[position] <= '9' && digits < 3; position++){
+            sum = sum * 10 + (value[position] - '0');
+            digits++;
+        }
+        if(digits == 0){
+            return false;
+        }
+        rules.cages[cage].sum = sum;
+
+        if(cage + 1 < rules.cages.size()){
+            if(position >= value.size() || value[position] != '/'){
+                return false;
+            }
+            position++;
+        }
+    }
+    return position == value.size();
+}
+
+/// @brief Adds the rules written as tokens (see VariantRules) to a set of rules.
+/// @param text The tokens, separated by spaces, tabs or commas.
+/// @param length The number of characters of text.
+/// @param rules Receives the rules.
+/// @return False on an unknown or malformed token.
+bool parse_rules(const char* text, size_t length, VariantRules& rules){
+
+    size_t i = 0;
+    while(i < length){
+        if(rule_separator(text[i])){
+            i++;
+            continue;
+        }
+        size_t start = i;
+        while(i < length && !rule_separator(text[i])){
+            i++;
+        }
+        string_view token(text + start, i - start);
+
+        if(token == "x"){
+            rules.diagonals = true;
+        }
+        else if(token == "anti-knight"){
+            rules.anti_knight = true;
+        }
+        else if(token.substr(0, 7) == "jigsaw="){
+            string_view value = token.substr(7);
+            if(value.size() != 81){
+                return false;
+            }
+            for(int cell = 0; cell < 81; cell++){
+                if(value[cell] < '1' || value[cell] > '9'){
+                    return false;
+                }
+                rules.regions[cell] = value[cell] - '1';
+            }
+        }
+        else if(token.substr(0, 7) == "killer="){
+            if(!parse_cages(token.substr(7), rules)){
+                return false;
+            }
+        }
+        else{
+            return false;
+        }
+    }
+    return true;
+}
+
+/*                                                  Rule tables                                                                  */
+
+/// @brief Builds the tables of a set of rules.
+/// @param rules The rules. Every region must have 9 cells; every cage 1 to 9 cells, none shared with another cage, and
+///         a sum that some set of different digits reaches.
+/// @return False if the layout breaks one of these, the tables are then unusable.
+bool VariantTable::compile(const VariantRules& rules){
+
+    units = 0;
+    combos.clear();
+    fill(cell_unit_count, cell_unit_count + 81, 0);
+    fill(knight_count, knight_count + 81, 0);
+    fill(cage_unit, cage_unit + 81, -1);
+
+    auto add_unit = [this](const int* members, int size, bool full){
+        int unit = units++;
+        unit_size[unit] = size;
+        unit_full[unit] = full;
+        combo_first[unit] = 0;
+        combo_count[unit] = 0;
+        for(int i = 0; i < size; i++){
+            unit_cells[unit][i] = members[i];
+            cell_units[members[i]][cell_unit_count[members[i]]++] = unit;
+        }
+        return unit;
+    };
+
+    // Rows and columns, then the regions.
+    for(int unit = 0; unit < 18; unit++){
+        add_unit(UNITS.cells[unit], 9, true);
+    }
+    int region_cells[9][9];
+    int region_size[9] = {0};
+    for(int cell = 0; cell < 81; cell++){
+        int region = rules.regions[cell];
+        if(region > 8 || region_size[region] == 9){
+            return false;
+        }
+        region_cells[region][region_size[region]++] = cell;
+    }
+    for(int region = 0; region < 9; region++){
+        add_unit(region_cells[region], 9, true);
+    }
+
+    if(rules.diagonals){
+        int main[9];
+        int anti[9];
+        for(int i = 0; i < 9; i++){
+            main[i] = i * 10;
+            anti[i] = (i + 1) * 8;
+        }
+        add_unit(main, 9, true);
+        add_unit(anti, 9, true);
+    }
+
+    // Cages, with every set of digits of their size and sum.
+    for(const Cage& cage : rules.cages){
+        int size = (int)cage.cells.size();
+        if(size < 1 || size > 9){
+            return false;
+        }
+        for(int cell : cage.cells){
+            if(cell < 0 || cell > 80 || cage_unit[cell] != -1){
+                return false;
+            }
+            cage_unit[cell] = units;
+        }
+
+        size_t first = combos.size();
+        for(uint16_t digits = 1; digits <= Grid::ALL; digits++){
+            int sum = 0;
+            for(uint16_t rest = digits; rest != 0; rest &= rest - 1){
+                sum += __builtin_ctz(rest) + 1;
+            }
+            if(__builtin_popcount(digits) == size && sum == cage.sum){
+                combos.push_back(digits);
+            }
+        }
+        if(combos.size() == first){
+            return false;
+        }
+
+        int unit = add_unit(cage.cells.data(), size, size == 9);
+        combo_first[unit] = first;
+        combo_count[unit] = combos.size() - first;
+    }
+
+    // Knight's-move peers, the ones that already share a unit with the cell are covered by it.
+    for(int cell = 0; rules.anti_knight && cell < 81; cell++){
+        static const int MOVES[8][2] = {{-2, -1}, {-2, 1}, {-1, -2}, {-1, 2}, {1, -2}, {1, 2}, {2, -1}, {2, 1}};
+        for(const int* move : MOVES){
+            int row = cell / 9 + move[0];
+            int column = cell % 9 + move[1];
+            if(row < 0 || row > 8 || column < 0 || column > 8){
+                continue;
+            }
+            int peer = row * 9 + column;
+
+            bool shared = false;
+            for(int i = 0; i < cell_unit_count[cell]; i++){
+                for(int j = 0; j < cell_unit_count[peer]; j++){
+                    shared = shared || cell_units[cell][i] == cell_units[peer][j];
+                }
+            }
+            if(!shared){
+                knights[cell][knight_count[cell]++] = peer;
+            }
+        }
+    }
+    return true;
+}
+
+/*                                                  Variant grid                                                                 */
+
+/// @brief Constructor for the VariantGrid class.
+/// @param table The compiled rules, must outlive the grid.
+VariantGrid::VariantGrid(const VariantTable& table) : table(&table){
+    memset(cells, 0, sizeof(cells));
+    for(int unit = 0; unit < table.units; unit++){
+        placed[unit] = 0;
+        cage_digits[unit] = ALL;
+        if(table.combo_count[unit] > 0){
+            update_cage(unit);
+        }
+    }
+}
+
+/// @brief Recomputes the digits a cage can still take: the ones of every digit set of the cage that holds all of its
+///         placed digits, minus the placed ones.
+void VariantGrid::update_cage(int unit){
+    Mask used = placed[unit];
+    Mask digits = 0;
+    const uint16_t* combo = &table->combos[table->combo_first[unit]];
+    for(int i = 0; i < table->combo_count[unit]; i++){
+        if((combo[i] & used) == used){
+            digits |= combo[i];
+        }
+    }
+    cage_digits[unit] = digits & ~used;
+}
+
+/// @brief Returns the digits a cell can take: none of its units or knight peers has them and its cage still fits them.
+VariantGrid::Mask VariantGrid::candidates(int cell) const{
+
+    Mask taken = 0;
+    for(int i = 0; i < table->cell_unit_count[cell]; i++){
+        taken |= placed[table->cell_units[cell][i]];
+    }
+    for(int i = 0; i < table->knight_count[cell]; i++){
+        taken |= (1u << cells[table->knights[cell][i]]) >> 1; // 0 for an empty peer
+    }
+
+    Mask digits = ALL & ~taken;
+    if(table->cage_unit[cell] >= 0){
+        digits &= cage_digits[table->cage_unit[cell]];
+    }
+    return digits;
+}
+
+/// @brief Puts a candidate digit in an empty cell and updates the unit masks.
+void VariantGrid::place(int cell, int val){
+    Mask bit = 1u << (val - 1);
+    cells[cell] = val;
+    for(int i = 0; i < table->cell_unit_count[cell]; i++){
+        placed[table->cell_units[cell][i]] |= bit;
+    }
+    if(table->cage_unit[cell] >= 0){
+        update_cage(table->cage_unit[cell]);
+    }
+}
+
+/// @brief Clears a filled cell and updates the unit masks.
+void VariantGrid::unplace(int cell){
+    Mask bit = 1u << (cells[cell] - 1);
+    cells[cell] = 0;
+    for(int i = 0; i < table->cell_unit_count[cell]; i++){
+        placed[table->cell_units[cell][i]] &= ~bit;
+    }
+    if(table->cage_unit[cell] >= 0){
+        update_cage(table->cage_unit[cell]);
+    }
+}
+
+/// @brief Reads a puzzle in the one-line format and places its givens.
+/// @param text At least 81 characters, '1'-'9' for givens and '.' or '0' for blanks.
+/// @return False if a character is not a digit or a blank, or a given breaks a rule with the givens before it.
+bool VariantGrid::parse(const char* text){
+
+    *this = VariantGrid(*table);
+
+    for(int cell = 0; cell < 81; cell++){
+        int val = Grid::digit(text[cell]);
+
+        if(val == 0){
+            continue;
+        }
+        if(val < 0 || !(candidates(cell) & (1u << (val - 1)))){
+            return false;
+        }
+        place(cell, val);
+    }
+    return true;
+}
+
+/// @brief Writes the grid in the one-line format, '.' for blanks. No newline or terminator is added.
+void VariantGrid::format(char* text) const{
+    for(int cell = 0; cell < 81; cell++){
+        text[cell] = cells[cell] ? Grid::symbol(cells[cell]) : '.';
+    }
+}
+
+/// @brief Picks the cell to branch on, as BasicGrid::best_branch does: an empty cell with the fewest candidates, or
+///         the only place of a digit in a unit that holds every digit.
+/// @param cell Receives the cell, -1 if every cell is filled.
+/// @param choices Receives the digits to try.
+/// @return False on a dead end: an empty cell with no candidates or a digit with no place in a full unit.
+bool VariantGrid::best_branch(int& cell, Mask& choices) const{
+
+    Mask options[81];
+    cell = -1;
+    int best_count = 10;
+
+    for(int i = 0; i < 81; i++){
+        if(cells[i] == 0){
+            options[i] = candidates(i);
+            int count = __builtin_popcount(options[i]);
+            if(count < best_count){
+                cell = i;
+                best_count = count;
+                if(count <= 1){
+                    choices = options[i];
+                    return count == 1;
+                }
+            }
+        }
+    }
+    if(cell == -1){
+        return true;
+    }
+
+    for(int unit = 0; unit < table->units; unit++){
+        if(!table->unit_full[unit]){
+            continue;
+        }
+        Mask once = placed[unit];
+        Mask twice = 0;
+
+        for(int i = 0; i < 9; i++){
+            int member = table->unit_cells[unit][i];
+            if(cells[member] == 0){
+                twice |= once & options[member];
+                once |= options[member];
+            }
+        }
+        if(once != ALL){
+            return false;
+        }
+
+        Mask single = once & ~twice & ~placed[unit];
+        if(single != 0){
+            choices = single & -single;
+            for(int i = 0; i < 9; i++){
+                int member = table->unit_cells[unit][i];
+                if(cells[member] == 0 && (options[member] & choices)){
+                    cell = member;
+                    return true;
+                }
+            }
+        }
+    }
+
+    choices = options[cell];
+    return true;
+}
+
+/// @brief Recursive backtracking where best_branch says.
+/// @return True if the remaining cells were solved, otherwise false, also once the budget of the thread is spent.
+bool VariantGrid::solve_helper(){
+
+    STAT_ADD(nodes, 1);
+    STAT_DEPTH();
+
+    if(!budget_node()){
+        return false;
+    }
+
+    int cell;
+    Mask choices;
+    if(!best_branch(cell, choices)){
+        return false;
+    }
+    if(cell == -1){
+        return true;
+    }
+
+    for(Mask mask = choices; mask != 0; mask &= mask - 1){
+        place(cell, __builtin_ctz(mask) + 1);
+        STAT_ADD(candidates_tried, 1);
+
+        if(solve_helper()){
+            return true;
+        }
+        unplace(cell);
+        STAT_ADD(backtracks, 1);
+    }
+    return false;
+}
+
+/// @brief Solves the grid in place.
+/// @return True if a solution was found, otherwise false and the grid is left as it was.
+bool VariantGrid::solve(){
+    return solve_helper();
+}
+
+/// @brief Counts the solutions below the grid, every placement is undone before returning.
+int VariantGrid::count_helper(int limit){
+
+    STAT_ADD(nodes, 1);
+    STAT_DEPTH();
+
+    if(!budget_node()){
+        return 0;
+    }
+
+    int cell;
+    Mask choices;
+    if(!best_branch(cell, choices)){
+        return 0;
+    }
+    if(cell == -1){
+        return 1;
+    }
+
+    int found = 0;
+    for(Mask mask = choices; mask != 0 && found < limit; mask &= mask - 1){
+        place(cell, __builtin_ctz(mask) + 1);
+        STAT_ADD(candidates_tried, 1);
+
+        found += count_helper(limit - found);
+        unplace(cell);
+        STAT_ADD(backtracks, 1);
+    }
+    return found;
+}
+
+/// @brief Counts the solutions with early exit, 2 tells a unique puzzle from one with several solutions.
+/// @return The number of solutions, at most limit.
+int VariantGrid::count(int limit){
+    return limit > 0 ? count_helper(limit) : 0;
+}
+
+/*                                                 Batch solving                                                                 */
+
+/// @brief One window of variant puzzles: the lines with their ends, and the output and totals slots.
+struct VariantWindow{
+    vector<const char*> lines;
+    vector<const char*> ends; // End of every line, the rules run up to it
+    vector<char> out;
+    vector<size_t> solved; // Solved puzzles per chunk
+    vector<size_t> exhausted; // Puzzles per chunk that ran out of budget
+};
+
+/// @brief Solves one variant puzzle line into an output line, 81 dots if the rules or the givens cannot be read, break
+///         a rule, have no solution or run out of budget.
+/// @param shared The tables of the rules of the options, used as they are when the line has no rules of its own.
+/// @return solved, unsolvable, or exhausted/cancelled if the budget ran out.
+static Outcome solve_variant_line(const char* line, const char* end, char* out, const VariantOptions& options,
+                                  const VariantTable& shared){
+
+    VariantTable own;
+    const VariantTable* table = &shared;
+    bool solved = true;
+
+    const char* rules_text = line + 81;
+    while(rules_text < end && rule_separator(*rules_text)){
+        rules_text++;
+    }
+    if(rules_text < end){
+        VariantRules rules = options.rules;
+        solved = parse_rules(rules_text, end - rules_text, rules) && own.compile(rules);
+        table = &own;
+    }
+
+    optional<BudgetScope> budget;
+    if(solved){
+        VariantGrid grid(*table);
+        if(options.budget.limited()){
+            budget.emplace(options.budget);
+        }
+        solved = grid.parse(line) && grid.solve();
+        if(solved){
+            grid.format(out);
+        }
+    }
+    if(!solved){
+        fill(out, out + 81, '.');
+    }
+    out[81] = '\n';
+
+    if(budget && budget->stopped()){
+        return budget->stop_reason();
+    }
+    return solved ? Outcome::solved : Outcome::unsolvable;
+}
+
+/// @brief Solves every puzzle of a file of variant puzzles on a work-stealing thread pool, in windows of
+///         VARIANT_WINDOW; each window is written out, in input order, while the next one is solved. A line holds the
+///         81 givens, then optionally the rules of that puzzle (see VariantRules), which add to the rules of the
+///         options. Lines shorter than 81 characters and lines starting with '#' are skipped.
+/// @param options The input and output files, the number of threads, the rules of every puzzle and the budget.
+/// @return The number of puzzles read and solved and the time it took.
+VariantResult solve_variant_batch(const VariantOptions& options){
+
+    MappedFile input;
+    BufferedWriter output;
+
+    // Handle invalid text file
+    if(!input.open(options.input)){
+        cerr << "ERROR: Failed to open " << options.input << ", check if file exists and try again." << endl;
+        exit(EXIT_FAILURE);
+    }
+    if(!output.open(options.output)){
+        cerr << "ERROR: Failed to open " << options.output << " for writing." << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    VariantTable shared;
+    if(!shared.compile(options.rules)){
+        cerr << "ERROR: The regions or cages of the rules are not a valid layout." << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    const char* input_end = input.data() + input.size();
+    LineScanner scanner(input.data(), input.size());
+    VariantResult result;
+    VariantWindow windows[2];
+    for(VariantWindow& window : windows){
+        window.out.resize(VARIANT_WINDOW * 82);
+    }
+
+    auto start = chrono::steady_clock::now();
+    {
+        ThreadPool pool(options.threads);
+
+        VariantWindow* solving = &windows[0];
+        VariantWindow* writing = nullptr;
+
+        while(true){
+            VariantWindow& window = *solving;
+
+            window.lines.clear();
+            window.ends.clear();
+            for(const char* line; window.lines.size() < VARIANT_WINDOW && (line = scanner.next()) != nullptr;){
+                const char* newline = (const char*)memchr(line, '\n', input_end - line);
+                window.lines.push_back(line);
+                window.ends.push_back(newline ? newline : input_end);
+            }
+            result.puzzles += window.lines.size();
+
+            size_t chunks = (window.lines.size() + VARIANT_CHUNK - 1) / VARIANT_CHUNK;
+            window.solved.assign(chunks, 0);
+            window.exhausted.assign(chunks, 0);
+
+            for(size_t chunk = 0; chunk < chunks; chunk++){
+                pool.submit([&window, &options, &shared, chunk] {
+                    size_t first = chunk * VARIANT_CHUNK;
+                    size_t last = min(first + VARIANT_CHUNK, window.lines.size());
+
+                    for(size_t i = first; i < last; i++){
+                        Outcome outcome = solve_variant_line(window.lines[i], window.ends[i], &window.out[i * 82],
+                                                             options, shared);
+                        window.solved[chunk] += outcome == Outcome::solved;
+                        window.exhausted[chunk] += outcome == Outcome::exhausted || outcome == Outcome::cancelled;
+                    }
+                });
+            }
+
+            // Write the previous window while this one is solving.
+            if(writing != nullptr){
+                output.write(writing->out.data(), writing->lines.size() * 82);
+            }
+
+            pool.wait();
+
+            for(size_t chunk = 0; chunk < chunks; chunk++){
+                result.solved += window.solved[chunk];
+                result.exhausted += window.exhausted[chunk];
+            }
+
+            if(window.lines.empty()){
+                break;
+            }
+            writing = solving;
+            solving = (solving == &windows[0]) ? &windows[1] : &windows[0];
+        }
+    }
+
+    if(!output.close()){
+        cerr << "ERROR: Failed to write the results." << endl;
+        exit(EXIT_FAILURE);
+    }
+    result.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef VARIANT_H
+#define VARIANT_H
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "budget.hpp"
+#include "grid.hpp"
+
+using namespace std;
+
+/// @brief A killer cage: its cells hold different digits that add up to sum.
+struct Cage{
+    vector<int> cells;
+    int sum = 0;
+};
+
+/// @brief Rules of a 9x9 variant puzzle, declared as data. Rows and columns always hold every digit once.
+///         Written as tokens, separated by spaces or commas:
+///           x                 both main diagonals hold every digit once
+///           anti-knight       cells a chess knight's move apart hold different digits
+///           jigsaw=REGIONS    81 characters '1'-'9', the irregular region of every cell, replacing the 3x3 boxes
+///           killer=CAGES:SUMS 81 characters, one letter per cage and '.' for cells outside any cage, then the sums
+///                             of the cages separated by '/', in the order the cages first appear in the grid
+struct VariantRules{
+    bool diagonals = false;
+    bool anti_knight = false;
+    array<uint8_t, 81> regions; // Region 0..8 of every cell, the 3x3 boxes unless a jigsaw layout is given
+    vector<Cage> cages;
+
+    VariantRules();
+};
+
+bool parse_rules(const char* text, size_t length, VariantRules& rules); // Adds the rules of the tokens, false on bad input
+
+/// @brief The rules of a variant compiled into the tables the solver reads: the cells of every unit, the units of every
+///         cell, the peers that share no unit with a cell (the knight's moves) and the digit sets each cage can hold.
+///         Units are the rows, the columns, the regions, the diagonals and the cages; all but the cages smaller than 9
+///         cells hold every digit. Built once per set of rules, every search node then only does table lookups.
+class VariantTable{
+    public:
+
+        static const int MAX_UNITS = 27 + 2 + 81; // Rows, columns and regions, the diagonals, at most one cage per cell
+        static const int MAX_CELL_UNITS = 6; // Row, column, region, both diagonals and a cage
+
+        bool compile(const VariantRules& rules); // False if the regions or cages are not a valid layout
+
+        int units = 0;
+        uint8_t unit_cells[MAX_UNITS][9];
+        uint8_t unit_size[MAX_UNITS];
+        bool unit_full[MAX_UNITS]; // The unit holds every digit once, not only different ones
+
+        uint8_t cell_units[81][MAX_CELL_UNITS];
+        uint8_t cell_unit_count[81];
+        uint8_t knights[81][8]; // Knight's-move peers outside the units of the cell, with anti-knight
+        uint8_t knight_count[81];
+
+        int16_t cage_unit[81]; // Unit of the cage of every cell, -1 outside the cages
+        vector<uint16_t> combos; // Digit sets of the right size and sum, cage after cage
+        uint16_t combo_first[MAX_UNITS]; // Range of the digit sets of a cage unit in combos
+        uint16_t combo_count[MAX_UNITS];
+};
+
+/// @brief Bitmask grid of a variant puzzle. Keeps the digits placed in every unit of the table as masks, so the
+///         candidates of a cell are the OR of its unit masks and the digits of its knight peers, narrowed to what its
+///         cage can still hold.
+class VariantGrid{
+    public:
+
+        using Mask = uint16_t;
+        static const Mask ALL = Grid::ALL;
+
+        explicit VariantGrid(const VariantTable& table); // An empty grid under the rules of the table
+
+        bool parse(const char* text); // Reads 81 characters, '.' or '0' for blanks, false on bad input or broken rules
+        void format(char* text) const; // Writes the 81 digits, '.' for blanks
+
+        void place(int cell, int val);
+        void unplace(int cell);
+        int get(int cell) const { return cells[cell]; }
+        Mask candidates(int cell) const;
+
+        bool solve(); // Solves in place, false and unchanged if there is no solution
+        int count(int limit); // Number of solutions, stopping at limit, the grid is unchanged
+
+    private:
+        bool best_branch(int& cell, Mask& choices) const;
+        bool solve_helper();
+        int count_helper(int limit);
+        void update_cage(int unit);
+
+        const VariantTable* table;
+        uint8_t cells[81];
+        Mask placed[VariantTable::MAX_UNITS]; // Digits placed in every unit
+        Mask cage_digits[VariantTable::MAX_UNITS]; // Digits a cage unit can still take, ALL for the other units
+};
+
+/// @brief Settings for a batch run of variant puzzles.
+struct VariantOptions{
+    string input; // File with one puzzle per line: 81 characters, then the rules of the puzzle
+    string output; // File the solutions are written to, empty for standard output
+    unsigned threads = 0; // Worker threads, 0 for one per core
+    VariantRules rules; // Rules of every puzzle, on top of the ones on its line
+    Budget budget; // Node and time limits of every puzzle, none by default
+};
+
+/// @brief Totals reported after a variant batch run.
+struct VariantResult{
+    size_t puzzles = 0;
+    size_t solved = 0;
+    size_t exhausted = 0; // Puzzles given up on when their budget ran out
+    double seconds = 0;
+};
+
+VariantResult solve_variant_batch(const VariantOptions& options); // Solves every puzzle of the file, in order
+
+#endif